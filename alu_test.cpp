@@ -1,8 +1,8 @@
 #include <iostream>
 #include <bitset>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include "Valu.h"
+#include "verilator_trace.h"
 
 static void dump_state(Valu* alu) {
     std::cout << "    A=0x" << std::hex << (int)alu->operand_a << " B=0x" << (int)alu->operand_b
@@ -17,11 +17,10 @@ int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Verilated::traceEverOn(true);
 
-    // Create DUT and VCD trace
+    // Create DUT and trace
     Valu* alu = new Valu;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    alu->trace(tfp, 99);
-    tfp->open("waveform_alu.vcd");
+    TraceFile* tfp = new TraceFile;
+    tfp->open(alu, "waveform_alu.vcd");
 
     uint64_t time = 0;
     auto eval_dump = [&](void) {
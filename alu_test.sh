@@ -1,6 +1,6 @@
 #!/bin/bash
-rm -rf obj_dir/
-verilator --cc alu.sv --exe alu_test.cpp --trace
-make -C obj_dir -f Valu.mk
-./obj_dir/Valu
+source ./trace_flags.sh
+verilator --cc alu.sv --Mdir obj_dir/alu --exe alu_test.cpp $TRACE_FLAGS
+make -C obj_dir/alu -f Valu.mk
+./obj_dir/alu/Valu
 # gtkwave waveform_alu.vcd
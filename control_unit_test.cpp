@@ -1,8 +1,8 @@
 #include <iostream>
 #include <iomanip>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include "Vcontrol_unit.h"
+#include "verilator_trace.h"
 
 // // Initialize expected values
 // uint8_t expected_opcode;
@@ -36,7 +36,7 @@ void print_instruction(uint8_t instr) {
 }
 
 
-bool test_r_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& time, uint32_t instruction = 0x00) {
+bool test_r_type_instruction(Vcontrol_unit* cu, TraceFile* tfp, uint64_t& time, uint32_t instruction = 0x00) {
     std::cout << "Test: R-Type (Register-Register) ";
     if (instruction != 0x00) {
         std::cout << "with instruction 0x" << std::setfill('0') << std::setw(8) << std::hex << instruction << std::dec;
@@ -128,7 +128,7 @@ bool test_r_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& ti
 }
 
 
-bool test_i_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& time, uint32_t instruction = 0x00) {
+bool test_i_type_instruction(Vcontrol_unit* cu, TraceFile* tfp, uint64_t& time, uint32_t instruction = 0x00) {
     std::cout << "Test: I-Type (Immediate/Loads/JALR) ";
     if (instruction != 0x00) {
         std::cout << "with instruction 0x" << std::setfill('0') << std::setw(8) << std::hex << instruction << std::dec;
@@ -223,7 +223,7 @@ bool test_i_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& ti
 }
 
 
-bool test_s_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& time, uint32_t instruction = 0x00) {
+bool test_s_type_instruction(Vcontrol_unit* cu, TraceFile* tfp, uint64_t& time, uint32_t instruction = 0x00) {
     std::cout << "Test: S-Type (Store) ";
     if (instruction != 0x00) {
         std::cout << "with instruction 0x" << std::setfill('0') << std::setw(8) << std::hex << instruction << std::dec;
@@ -333,7 +333,7 @@ bool test_s_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& ti
 }
 
 
-bool test_u_type_instruction(Vcontrol_unit* cu, VerilatedVcdC* tfp, uint64_t& time, uint32_t instruction = 0x00) {
+bool test_u_type_instruction(Vcontrol_unit* cu, TraceFile* tfp, uint64_t& time, uint32_t instruction = 0x00) {
     std::cout << "Test: U-Type (LUI/AUIPC) ";
     if (instruction != 0x00) {
         std::cout << "with instruction 0x" << std::setfill('0') << std::setw(8) << std::hex << instruction << std::dec;
@@ -411,11 +411,10 @@ int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Verilated::traceEverOn(true);
     
-    // Create module and VCD trace
+    // Create module and trace
     Vcontrol_unit* cu = new Vcontrol_unit;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    cu->trace(tfp, 99);
-    tfp->open("waveform_cu.vcd");
+    TraceFile* tfp = new TraceFile;
+    tfp->open(cu, "waveform_cu.vcd");
     
     uint64_t time = 0;
     bool test_result = false;
@@ -1,7 +1,7 @@
 #!/bin/bash
 # Test Control Unit Decoder
-rm -rf obj_dir/
-verilator --cc control_unit.sv --exe control_unit_test.cpp --trace
-make -C obj_dir -f Vcontrol_unit.mk
-./obj_dir/Vcontrol_unit
+source ./trace_flags.sh
+verilator --cc control_unit.sv --Mdir obj_dir/control_unit --exe control_unit_test.cpp $TRACE_FLAGS
+make -C obj_dir/control_unit -f Vcontrol_unit.mk
+./obj_dir/control_unit/Vcontrol_unit
 # gtkwave waveform_cu.vcd
@@ -0,0 +1,76 @@
+#include "golden_model_cpu.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+// Golden model throughput benchmark
+// Runs every program with the interpreter core and the basic-block engine and
+// reports millions of retired instructions per second. Build it twice (with and
+// without -DGOLDEN_MODEL_SWITCH_DISPATCH) to compare the two dispatch cores.
+
+const int BENCH_CHUNK = 1000000;
+
+
+// Every engine starts from `initial`, the freshly loaded program, so they all
+// run the same instructions on the same memory
+double run_benchmark(GoldenModelCPU* cpu, const CpuSnapshot& initial, ExecutionEngine engine, long long cycles) {
+    cpu->engine = engine;
+    cpu->restore(initial);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long long done = 0; done < cycles; done += BENCH_CHUNK) {
+        long long chunk = cycles - done < BENCH_CHUNK ? cycles - done : BENCH_CHUNK;
+        cpu->runCycles((int)chunk);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return cycles / elapsed.count() / 1e6;
+}
+
+
+int main(int argc, char** argv) {
+    long long cycles = 50000000;
+    std::vector<std::string> hex_files;
+
+    // Usage: golden_model_bench [cycles] [hex files...]
+    if (argc > 1) {
+        cycles = std::stoll(argv[1]);
+    }
+    for (int i = 2; i < argc; i++) {
+        hex_files.push_back(argv[i]);
+    }
+    if (hex_files.empty()) {
+        hex_files.push_back("logisim-bin/sum.hex");
+        hex_files.push_back("logisim-bin/test-vga.hex");
+    }
+
+    std::cout << "Golden model benchmark (" << GoldenModelCPU::dispatchMode() << " dispatch, "
+              << cycles << " cycles per run)\n";
+    std::cout << "==================================================\n";
+
+    for (size_t i = 0; i < hex_files.size(); i++) {
+        GoldenModelCPU* cpu = new GoldenModelCPU;
+        try {
+            if (!cpu->loadProgram(hex_files[i])) {
+                delete cpu;
+                return 1;
+            }
+            cpu->resetCPU();
+            CpuSnapshot initial = cpu->snapshot();
+            double interpreter_mips = run_benchmark(cpu, initial, ExecutionEngine::Interpreter, cycles);
+            double block_mips = run_benchmark(cpu, initial, ExecutionEngine::BasicBlock, cycles);
+
+            std::cout << std::left << std::setw(28) << hex_files[i] << std::right << std::fixed << std::setprecision(1)
+                      << " interpreter: " << std::setw(7) << interpreter_mips << " MIPS"
+                      << "  basic-block: " << std::setw(7) << block_mips << " MIPS\n";
+        } catch (const std::exception& e) {
+            std::cout << std::left << std::setw(28) << hex_files[i] << " skipped: " << e.what() << "\n";
+        }
+        delete cpu;
+    }
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Compile the golden model benchmark with both interpreter dispatch cores and compare them
+
+BUILD_DIR="build"
+CYCLES="${1:-50000000}"
+shift
+HEX_FILES="$@"
+
+mkdir -p "$BUILD_DIR"
+
+echo "Compiling golden_model_bench (threaded dispatch)..."
+g++ -O2 -o "$BUILD_DIR/golden_model_bench_threaded" \
+    golden_model_bench.cpp golden_model_cpu.cpp golden_model_memory.cpp memory_fabric.cpp vga_device.cpp uart_device.cpp halt_detector.cpp program_image.cpp \
+    -std=c++11 -Wall
+if [ $? -ne 0 ]; then
+    echo "Error: Compilation failed!"
+    exit 1
+fi
+
+echo "Compiling golden_model_bench (switch dispatch)..."
+g++ -O2 -DGOLDEN_MODEL_SWITCH_DISPATCH -o "$BUILD_DIR/golden_model_bench_switch" \
+    golden_model_bench.cpp golden_model_cpu.cpp golden_model_memory.cpp memory_fabric.cpp vga_device.cpp uart_device.cpp halt_detector.cpp program_image.cpp \
+    -std=c++11 -Wall
+if [ $? -ne 0 ]; then
+    echo "Error: Compilation failed!"
+    exit 1
+fi
+
+./"$BUILD_DIR/golden_model_bench_switch" "$CYCLES" $HEX_FILES
+echo ""
+./"$BUILD_DIR/golden_model_bench_threaded" "$CYCLES" $HEX_FILES
@@ -7,103 +7,157 @@
 #include <cstring>
 #include <bitset>
 #include <stdexcept>
+#include <unordered_map>
 
 // Golden Model CPU for miniRV (RISC-V RV32E subset)
 // This is a functional C++ model that executes instructions from hex files
+
+// Interpreter core: direct-threaded dispatch through GCC/Clang labels-as-values,
+// or a portable switch loop when built with -DGOLDEN_MODEL_SWITCH_DISPATCH
+#if defined(__GNUC__) && !defined(GOLDEN_MODEL_SWITCH_DISPATCH)
+#define GOLDEN_MODEL_THREADED_DISPATCH 1
+#else
+#define GOLDEN_MODEL_THREADED_DISPATCH 0
+#endif
+
 int CYCLE_LIMIT = 6000;
 std::string INSTRUCTION_MEMORY_FILE = "logisim-bin/sum.hex";
 bool DEBUG_MODE = false;
 
+// DebugTrace: verbose per-instruction trace used when DEBUG_MODE is set
+
+void DebugTrace::fetch(const GoldenModelCPU& cpu, uint32_t instr) {
+    std::cout << "PC: 0x" << std::hex << cpu.pc << std::dec << std::endl;
+    std::cout << "Instruction: 0x" << std::hex << std::setfill('0') << std::setw(8) << instr << std::dec << std::endl;
+    std::cout << "Instruction: 0b" << std::bitset<32>(instr) << std::endl;
+}
+
+
+void DebugTrace::beforeExecute(const GoldenModelCPU& cpu, const DecodedInstruction& d) {
+    uint8_t rd = d.rd;
+    uint8_t rs1 = d.rs1;
+    int32_t imm = d.imm;
+
+    uint32_t instr = cpu.imem[cpu.pc >> 2];
+    uint8_t funct3 = (instr >> 12) & 0x7;
+    uint8_t funct7 = (instr >> 25) & 0x7F;
+
+    switch (d.op) {
+        case OP_ADDI:
+            std::cout << "ADDI: rd = x" << (int)rd 
+            << ", rs1 = x" << (int)rs1 << "(0x" << std::hex << cpu.registers[rs1] << std::dec << ")"
+            << ", imm_i = " << imm << " (0x" << std::hex << imm << std::dec << ")" << std::endl;
+            break;
+        case OP_LUI:
+            std::cout << "LUI: rd = x" << (int)rd 
+            << " <- imm_u = 0x" << std::hex << (uint32_t)imm << std::dec << std::endl;
+            break;
+        case OP_LW:
+        case OP_LBU: {
+            std::cout << "LW: rd = x" << (int)rd 
+            << ", rs1 = x" << (int)rs1 
+            << ", imm_i = " << imm << " (0x" << std::hex << imm << std::dec << ")" 
+            << ", funct3 = 0b" << std::bitset<3>(funct3) << std::dec
+            << ", funct7 = 0b" << std::bitset<7>(funct7) << std::dec
+            << std::endl;
+            uint32_t addr = cpu.registers[rs1] + imm;
+            std::cout << (d.op == OP_LW ? "LW" : "LBU") << ": rd = x" << (int)rd 
+                        << ", rs1 = x" << (int)rs1 
+                        << ", imm_i = " << imm 
+                        << ", addr = 0x" << std::hex << addr << std::dec 
+                        << " (word_index: 0x" << std::hex << (addr >> 2) << std::dec << ")"
+                        << std::endl;
+            break;
+        }
+        case OP_SW:
+        case OP_SB:
+            std::cout << "STORE: rs1 = x" << (int)rs1 << "(0x" << std::hex << cpu.registers[rs1] << std::dec << ")"
+            << ", rs2 = x" << (int)d.rs2 << "(0x" << std::hex << cpu.registers[d.rs2] << std::dec << ")"
+            << ", imm_s = 0x" << std::hex << imm << std::dec 
+            << ", funct3 = 0b" << std::bitset<3>(funct3) << std::dec
+            << ", funct7 = 0b" << std::bitset<7>(funct7) << std::dec
+            << std::endl;
+            break;
+        default:
+            break;
+    }
+}
+
+
+void DebugTrace::afterExecute(const GoldenModelCPU& cpu, const DecodedInstruction& d, uint32_t next_pc) {
+    uint8_t rd = d.rd;
+    uint8_t rs1 = d.rs1;
+    uint8_t rs2 = d.rs2;
+    int32_t imm = d.imm;
+
+    switch (d.op) {
+        case OP_ADD:
+            std::cout << "ADD: rd = x" << (int)rd 
+            << ", rs1 = x" << (int)rs1 
+            << ", rs2 = x" << (int)rs2 
+            << std::endl;
+            std::cout << "ADD: rd = x" << (int)rd << " = 0x" << std::hex << cpu.registers[rd] << std::dec << std::endl;
+            break;
+        case OP_ADDI:
+            std::cout << "ADDI: rd = x" << (int)rd << " = 0x" << std::hex << cpu.registers[rd] << std::dec << std::endl;
+            break;
+        case OP_SW:
+        case OP_SB: {
+            uint32_t addr = cpu.registers[rs1] + imm;
+            std::cout << (d.op == OP_SW ? "STORE" : "SB") << ": dmem[0x" << std::hex << addr << std::dec << "] = 0x" << std::hex << cpu.registers[rs2] << std::dec 
+            << " (real addr >> 2: 0x" << std::hex << (addr >> 2) << std::dec << ")"
+            << std::endl;
+            break;
+        }
+        case OP_JALR:
+            std::cout << "JALR: rd = x" << (int)rd 
+            << ", rs1 = x" << (int)rs1 
+            << ", imm_i = " << imm << std::endl;
+            std::cout << "JALR: pc_new = 0x" << std::hex << next_pc << std::dec 
+            << ", pc_saved pc + 4 = 0x" << std::hex << (cpu.pc + 4) << std::dec 
+            << " in register x" << (int)rd << std::endl;
+            break;
+        default:
+            break;
+    }
+}
+
+
 // GoldenModelCPU class implementation
 
 // Constructor
-GoldenModelCPU::GoldenModelCPU() : clock(false), reset(false), pc(0) {
+GoldenModelCPU::GoldenModelCPU(size_t imem_words, size_t dmem_words)
+    : clock(false), reset(false), pc(0),
+      imem(imem_words * 4), dmem(dmem_words * 4), bus(dmem),
+      engine(ExecutionEngine::Interpreter), retire_record(nullptr) {
     // Initialize registers (x0 is always 0, others can be 0 initially)
-    for (int i = 0; i < REGISTER_LIMIT; i++) {
+    for (size_t i = 0; i < REGISTER_LIMIT; i++) {
         registers[i] = 0;
     }
     
-    // Initialize memories
-    memset(imem, 0, sizeof(imem));
-    memset(dmem, 0, sizeof(dmem));
+    // Memories start out zero (pages are allocated lazily on first write)
+
+    // MMIO devices
+    bus.mapDevice(VgaFramebuffer::BASE, VgaFramebuffer::BYTES, &vga, "vga");
+    bus.mapDevice(UartDevice::BASE, UartDevice::SIZE, &uart, "uart");
+    bus.mapDevice(ExitPort::BASE, ExitPort::SIZE, &exit_port, "exit");
 
     pc = 0;
     // loadHexFile(INSTRUCTION_MEMORY_FILE);
 }
     
 
-// Load instructions from hex file (Logisim format)
-bool GoldenModelCPU::loadHexFile(const std::string& filename) {
+// Load a program file into instruction and data memory
+bool GoldenModelCPU::loadProgram(const std::string& filename) {
     if (DEBUG_MODE) {
         std::cout << "Loading instructions from " << filename << " into instruction memory...\n";
     }
-    
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error: Cannot open file " << filename << std::endl;
-        return false;
-    }
 
-    std::string memh_filename = filename.substr(0, filename.find(".")) + ".memh";
-    std::ofstream memh_file(memh_filename);
-    if (!memh_file.is_open()) {
-        std::cerr << "Error: Cannot create file " << memh_filename << std::endl;
+    ProgramImage image;
+    if (!image.loadCached(filename)) {
         return false;
     }
-    
-    std::string line;
-    bool first_line = true;
-    
-    while (std::getline(file, line)) {
-        // Skip empty lines
-        if (line.empty()) continue;
-        
-        // Skip version header line
-        if (first_line && line.find("v3.0") != std::string::npos) {
-            first_line = false;
-            continue;
-        }
-        first_line = false;
-        
-        // Parse line: address: instruction1 instruction2 ...
-        size_t colon_pos = line.find(':');
-        if (colon_pos == std::string::npos) continue;
-        
-        std::string addr_str = line.substr(0, colon_pos);
-        std::string instr_str = line.substr(colon_pos + 1);
-        
-        // Parse base address
-        uint32_t base_addr = std::stoul(addr_str, nullptr, 16);
-        // base_addr = base_addr >> 2;  // Convert byte address to word index
-        
-        // Parse instructions
-        std::istringstream iss(instr_str);
-        std::string instr_hex;
-        uint32_t offset = 0;
-        
-        while (iss >> instr_hex) {
-            if (instr_hex.empty()) continue;
-            
-            uint32_t instr = std::stoul(instr_hex, nullptr, 16);
-            uint32_t word_addr = base_addr + offset;
-            
-            if (word_addr < IMEM_SIZE) {
-                imem[word_addr] = instr;
-                dmem[word_addr] = instr;
-
-                memh_file << std::hex << std::uppercase << std::setfill('0') << std::setw(8) << instr << std::endl;
-            } else {
-                std::cerr << "Warning: Instruction address " << word_addr 
-                            << " exceeds memory size" << std::endl;
-                throw std::runtime_error("Memory address out of bounds");
-            }
-            
-            offset++;
-        }
-    }
-    
-    file.close();
-    memh_file.close();
+    loadImage(image);
 
     if (DEBUG_MODE) {
         std::cout << "Instructions loaded successfully from " << filename << "\n";
@@ -114,253 +168,495 @@ bool GoldenModelCPU::loadHexFile(const std::string& filename) {
 }
 
 
+// Load instructions from hex file (Logisim format)
+bool GoldenModelCPU::loadHexFile(const std::string& filename) {
+    return loadProgram(filename);
+}
+
+
+// Copy every segment into imem and dmem, then decode the loaded words once
+void GoldenModelCPU::loadImage(const ProgramImage& image) {
+    const std::vector<ProgramSegment>& segments = image.segments();
+
+    for (size_t i = 0; i < segments.size(); i++) {
+        const ProgramSegment& segment = segments[i];
+        uint64_t segment_end = (uint64_t)segment.base + segment.data.size();
+        if (segment_end > imem.size() || segment_end > dmem.size()) {
+            std::cerr << "Warning: Instruction address " << ((segment_end - 1) >> 2)
+                        << " exceeds memory size" << std::endl;
+            throw std::runtime_error("Memory address out of bounds");
+        }
+    }
+
+    for (size_t i = 0; i < segments.size(); i++) {
+        const ProgramSegment& segment = segments[i];
+        if (segment.data.empty()) continue;
+        imem.writeBlock(segment.base, segment.data.data(), segment.data.size());
+        dmem.writeBlock(segment.base, segment.data.data(), segment.data.size());
+        invalidateDecoded(segment.base >> 2, (uint32_t)((segment.base + segment.data.size() + 3) >> 2));
+    }
+}
+
+
+// Zero imem, dmem and the framebuffer (touching only dirty pages) and drop decoded state
+void GoldenModelCPU::clearMemory() {
+    imem.clear();
+    dmem.clear();
+    vga.clear();
+    decoded.clear();
+    flushBlocks();
+}
+
+
 // Reset CPU
 void GoldenModelCPU::resetCPU() {
     reset = true;
     pc = 0;
-    for (int i = 0; i < REGISTER_LIMIT; i++) {
+    for (size_t i = 0; i < REGISTER_LIMIT; i++) {
         registers[i] = 0;
     }
+    exit_port.clear();
     reset = false;
 }
 
 
-// Execute one instruction (single cycle)
-bool GoldenModelCPU::executeInstruction() {
-    // Fetch instruction
-    uint32_t word_index = pc >> 2;
-    if (word_index >= IMEM_SIZE) {
-        std::cerr << "Error: PC out of bounds: 0x" << std::hex << pc << std::dec << std::endl;
-        throw std::runtime_error("PC out of bounds");
-        return false;
-    }
-    
-    uint32_t instr = imem[word_index];
+// Capture the architectural state; memory pages are shared copy-on-write
+CpuSnapshot GoldenModelCPU::snapshot(uint64_t cycle) {
+    CpuSnapshot snap;
+    snap.cycle = cycle;
+    snap.clock = clock;
+    snap.reset = reset;
+    snap.pc = pc;
+    memcpy(snap.registers, registers, sizeof(registers));
+    snap.decoded_words = (uint32_t)decoded.size();
+    snap.imem = imem.snapshot();
+    snap.dmem = dmem.snapshot();
+    snap.devices.capture(vga, exit_port);
+    return snap;
+}
 
-    if (DEBUG_MODE) {
-        std::cout << "PC: 0x" << std::hex << pc << std::dec << std::endl;
-        std::cout << "Instruction: 0x" << std::hex << std::setfill('0') << std::setw(8) << instr << std::dec << std::endl;
-        std::cout << "Instruction: 0b" << std::bitset<32>(instr) << std::endl;
+
+// Restore a snapshot. Restarting from a checkpoint of the same program leaves
+// imem untouched, so the decoded program and translated blocks stay valid.
+void GoldenModelCPU::restore(const CpuSnapshot& snap) {
+    clock = snap.clock;
+    reset = snap.reset;
+    pc = snap.pc;
+    memcpy(registers, snap.registers, sizeof(registers));
+
+    if (!imem.matches(snap.imem)) {
+        imem.restore(snap.imem);
+        decoded.clear();
+        invalidateDecoded(0, snap.decoded_words);
     }
-    
-    // Decode instruction
+    dmem.restore(snap.dmem);
+    snap.devices.apply(vga, exit_port);
+}
+
+
+// Decode a raw instruction word into its handler index and fields.
+// Every check that only depends on the encoding (funct3/funct7, register
+// numbers) is resolved here, so executeInstruction only has to dispatch.
+DecodedInstruction GoldenModelCPU::decodeInstruction(uint32_t instr) {
     uint8_t opcode = instr & 0x7F;
     uint8_t rd = (instr >> 7) & 0x1F;
     uint8_t funct3 = (instr >> 12) & 0x7;
     uint8_t rs1 = (instr >> 15) & 0x1F;
     uint8_t rs2 = (instr >> 20) & 0x1F;
     uint8_t funct7 = (instr >> 25) & 0x7F;
-    
-    // Calculate PC+4
-    uint32_t pc_plus4 = pc + 4;
-    
-    // Initialize next PC to PC+4 (sequential execution)
-    uint32_t next_pc = pc_plus4;
-    
+
     // Extract immediate values
     int32_t imm_i = (int32_t)(instr) >> 20;  // Sign-extended 12-bit immediate
     int32_t imm_s = ((int32_t)(instr & 0xFE000000) >> 20) | ((instr >> 7) & 0x1F);
     if (imm_s & 0x800) imm_s |= 0xFFFFF800;  // Sign extend
     uint32_t imm_u = instr & 0xFFFFF000;  // Upper 20 bits, lower 12 bits are 0
-    
-    // Execute instruction based on opcode
+
+    DecodedInstruction d;
+    d.op = OP_NOP;
+    d.rd = rd;
+    d.rs1 = rs1;
+    d.rs2 = rs2;
+    d.imm = imm_i;
+
+    bool regs_ok = rd < REGISTER_LIMIT && rs1 < REGISTER_LIMIT;
+
     switch (opcode) {
-        case 0x33: {  // R-Type: ADD
-            if (DEBUG_MODE) {
-                std::cout << "ADD: rd = x" << (int)rd 
-                << ", rs1 = x" << (int)rs1 
-                << ", rs2 = x" << (int)rs2 
-                << std::endl;
-            }
+        case 0x33:  // R-Type: ADD
+            if (funct3 == 0x0 && funct7 == 0x0 && regs_ok && rs2 < REGISTER_LIMIT) d.op = OP_ADD;
+            else d.op = OP_ILLEGAL;
+            break;
+        case 0x13:  // I-Type: ADDI
+            d.op = (funct3 == 0x0 && regs_ok) ? OP_ADDI : OP_ILLEGAL;
+            break;
+        case 0x37:  // U-Type: LUI
+            d.op = (rd < REGISTER_LIMIT && rd != 0) ? OP_LUI : OP_ILLEGAL;
+            d.imm = (int32_t)imm_u;
+            break;
+        case 0x03:  // I-Type: Load instructions (illegal registers are ignored)
+            if (!regs_ok) d.op = OP_NOP;
+            else if (funct3 == 0x2) d.op = OP_LW;
+            else if (funct3 == 0b100) d.op = OP_LBU;
+            else d.op = OP_ILLEGAL;
+            break;
+        case 0x23:  // S-Type: Store instructions
+            d.imm = imm_s;
+            if (rs1 >= REGISTER_LIMIT || rs2 >= REGISTER_LIMIT) d.op = OP_ILLEGAL;
+            else if (funct3 == 0x2) d.op = OP_SW;
+            else if (funct3 == 0b000) d.op = OP_SB;
+            else d.op = OP_ILLEGAL;
+            break;
+        case 0x67:  // I-Type: JALR (other funct3 values fall through as NOP)
+            if (funct3 == 0x0) d.op = regs_ok ? OP_JALR : OP_ILLEGAL;
+            break;
+        default:
+            // Unknown instruction - treat as NOP (just increment PC)
+            break;
+    }
+    return d;
+}
+
+
+// Re-decode one imem word after it has been written.
+// imem is only written by loadImage: stores go to dmem (Harvard, like the
+// RTL instruction_fetch ROM), so they never alias a decoded word.
+void GoldenModelCPU::invalidateDecoded(uint32_t word_index) {
+    if (word_index >= decoded.size()) {
+        decoded.resize(word_index + 1, nop_instruction);
+    }
+    decoded[word_index] = decodeInstruction(imem[word_index]);
+    flushBlocks();
+}
+
+
+void GoldenModelCPU::invalidateDecoded(uint32_t first_word, uint32_t end_word) {
+    if (end_word > decoded.size()) {
+        decoded.resize(end_word, nop_instruction);
+    }
+    for (uint32_t word = first_word; word < end_word; word++) {
+        decoded[word] = decodeInstruction(imem[word]);
+    }
+    flushBlocks();
+}
+
+
+// Decoded form of a zero word, returned above the loaded program
+const DecodedInstruction GoldenModelCPU::nop_instruction = GoldenModelCPU::decodeInstruction(0);
 
+
+// Decoded entry for an imem word, throws when the PC is out of bounds
+inline const DecodedInstruction& GoldenModelCPU::fetchDecoded(uint32_t word_index) const {
+    if (word_index < decoded.size()) {
+        return decoded[word_index];
+    }
+    if (word_index >= (imem.size() >> 2)) {
+        std::cerr << "Error: PC out of bounds: 0x" << std::hex << (word_index << 2) << std::dec << std::endl;
+        throw std::runtime_error("PC out of bounds");
+    }
+    return nop_instruction;
+}
+
+
+// Slow path for OP_ILLEGAL: report the error exactly as the decoder saw it
+void GoldenModelCPU::executeIllegal(uint32_t instr) {
+    uint8_t opcode = instr & 0x7F;
+    uint8_t rd = (instr >> 7) & 0x1F;
+    uint8_t funct3 = (instr >> 12) & 0x7;
+    uint8_t rs1 = (instr >> 15) & 0x1F;
+    uint8_t rs2 = (instr >> 20) & 0x1F;
+    uint8_t funct7 = (instr >> 25) & 0x7F;
+    DecodedInstruction d = decodeInstruction(instr);
+
+    switch (opcode) {
+        case 0x33:  // ADD: illegal registers are reported but not fatal
             if (funct3 == 0x0 && funct7 == 0x0) {
-                if (rd < REGISTER_LIMIT && rs1 < REGISTER_LIMIT && rs2 < REGISTER_LIMIT) {
-                    registers[rd] = registers[rs1] + registers[rs2];
-                    if (DEBUG_MODE) {
-                        std::cout << "ADD: rd = x" << (int)rd << " = 0x" << std::hex << registers[rd] << std::dec << std::endl;
-                    }
-                } else {
-                    std::cerr << "Error: Illegal register: rd = " << (int)rd << ", rs1 = " << (int)rs1 << ", rs2 = " << (int)rs2 << std::endl;
-                    // throw std::runtime_error("Illegal register");
-                }
-            } else {
-                std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << ", funct7 = 0b" << std::bitset<7>(funct7) << std::endl;
-                throw std::runtime_error("Illegal function");
+                std::cerr << "Error: Illegal register: rd = " << (int)rd << ", rs1 = " << (int)rs1 << ", rs2 = " << (int)rs2 << std::endl;
+                return;
             }
             break;
-        }
-        
-        case 0x13: {  // I-Type: ADDI
-            if (DEBUG_MODE) {
-                std::cout << "ADDI: rd = x" << (int)rd 
-                << ", rs1 = x" << (int)rs1 << "(0x" << std::hex << registers[rs1] << std::dec << ")"
-                << ", imm_i = " << imm_i << " (0x" << std::hex << imm_i << std::dec << ")" << std::endl;
-            }
+        case 0x13:  // ADDI
             if (funct3 == 0x0) {
-                if (rd < REGISTER_LIMIT && rs1 < REGISTER_LIMIT) {
-                    registers[rd] = registers[rs1] + imm_i;
-                    if (DEBUG_MODE) {
-                        std::cout << "ADDI: rd = x" << (int)rd << " = 0x" << std::hex << registers[rd] << std::dec << std::endl;
-                    }
-                } else {
-                    std::cerr << "Error: Illegal register: rd = " << (int)rd << ", rs1 = " << (int)rs1 << std::endl;
-                    throw std::runtime_error("Illegal register");
-                }
-            } else {
-                std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << ", funct7 = 0b" << std::bitset<7>(funct7) << std::endl;
-                throw std::runtime_error("Illegal function");
-            }
-            break;
-        }
-        
-        case 0x37: {  // U-Type: LUI
-            if (DEBUG_MODE) {
-                std::cout << "LUI: rd = x" << (int)rd 
-                << " <- imm_u = 0x" << std::hex << imm_u << std::dec << std::endl;
-            }
-            if (rd < REGISTER_LIMIT && rd != 0) {
-                registers[rd] = imm_u;
-            } else {
-                std::cerr << "Error: Illegal register: rd = " << (int)rd << std::endl;
+                std::cerr << "Error: Illegal register: rd = " << (int)rd << ", rs1 = " << (int)rs1 << std::endl;
                 throw std::runtime_error("Illegal register");
             }
             break;
+        case 0x37:  // LUI
+            std::cerr << "Error: Illegal register: rd = " << (int)rd << std::endl;
+            throw std::runtime_error("Illegal register");
+        case 0x03: {  // Load: unknown funct3 only faults inside data memory
+            if (!bus.mapped(registers[rs1] + d.imm)) return;
+            std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << std::endl;
+            throw std::runtime_error("Illegal function");
         }
-        
-        case 0x03: {  // I-Type: Load instructions
-            if (DEBUG_MODE) {
-                std::cout << "LW: rd = x" << (int)rd 
-                << ", rs1 = x" << (int)rs1 
-                << ", imm_i = " << imm_i << " (0x" << std::hex << imm_i << std::dec << ")" 
-                << ", funct3 = 0b" << std::bitset<3>(funct3) << std::dec
-                << ", funct7 = 0b" << std::bitset<7>(funct7) << std::dec
-                << std::endl;
-            }
-            if (rd < REGISTER_LIMIT && rs1 < REGISTER_LIMIT) {
-                uint32_t addr = registers[rs1] + imm_i;
-                uint32_t word_addr = addr >> 2;
-                
-                if (word_addr < DMEM_SIZE) {
-                    // Read 32-bit word directly (word-addressable memory)
-                    uint32_t dmem_rdata = dmem[word_addr];
-                    
-                    if (funct3 == 0x2) {  // LW - Load word (32-bit)
-                        if (DEBUG_MODE) {
-                            std::cout << "LW: rd = x" << (int)rd 
-                                        << ", rs1 = x" << (int)rs1 
-                                        << ", imm_i = " << imm_i 
-                                        << ", addr = 0x" << std::hex << addr << std::dec 
-                                        << " (word_index: 0x" << std::hex << word_addr << std::dec << ")"
-                                        << std::endl;
-                        }
-                        if (rd != 0) {
-                            registers[rd] = dmem_rdata;
-                        }
-                    } else if (funct3 == 0b100) {  // LBU - Load byte unsigned (8-bit)
-                        //Load Byte Unsigned: Loads 8 bits from memory and zero-extends them to 32 bits.
-                        //addr = R[rs1] + imm; R[rd] = {24'b0, M[addr][7:0]}
-                        if (DEBUG_MODE) {
-                            std::cout << "LBU: rd = x" << (int)rd 
-                                        << ", rs1 = x" << (int)rs1 
-                                        << ", imm_i = " << imm_i 
-                                        << ", addr = 0x" << std::hex << addr << std::dec 
-                                        << " (word_index: 0x" << std::hex << word_addr << std::dec << ")"
-                                        << std::endl;
-                        }
-                        if (rd != 0) {
-                            registers[rd] = (uint32_t)(dmem_rdata & 0x000000FF);
-                        }
-                    } else {
-                        std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << std::endl;
-                        throw std::runtime_error("Illegal function");
-                    }
-                }
-            }
-            break;
-        }
-        
-        case 0x23: {  // S-Type: Store instructions
-            if (DEBUG_MODE) {
-                std::cout << "STORE: rs1 = x" << (int)rs1 << "(0x" << std::hex << registers[rs1] << std::dec << ")"
-                << ", rs2 = x" << (int)rs2 << "(0x" << std::hex << registers[rs2] << std::dec << ")"
-                << ", imm_s = 0x" << std::hex << imm_s << std::dec 
-                << ", funct3 = 0b" << std::bitset<3>(funct3) << std::dec
-                << ", funct7 = 0b" << std::bitset<7>(funct7) << std::dec
-                << std::endl;
-            }
-            
-            if (rs1 < REGISTER_LIMIT && rs2 < REGISTER_LIMIT) {
-                uint32_t addr = registers[rs1] + imm_s;
-                uint32_t word_addr = addr >> 2;
-                uint32_t dmem_wdata = registers[rs2];
-
-                if (word_addr < DMEM_SIZE) {
-                    if (funct3 == 0x2) { // SW - Store word (32-bit)
-                        // Store full 32-bit word
-                        // funct3 = 0b010 (SW)
-                        dmem[word_addr] = dmem_wdata;
-                        if (DEBUG_MODE) {
-                            std::cout << "STORE: dmem[0x" << std::hex << addr << std::dec << "] = 0x" << std::hex << dmem_wdata << std::dec 
-                            << " (real addr >> 2: 0x" << std::hex << word_addr << std::dec << ")"
-                            << std::endl;
-                        }
-                    } else if (funct3 == 0b000) {  // SB - Store byte (8-bit)
-                        // Store Byte: Stores the lowest 8 bits of a register into memory.
-                        // addr = R[rs1] + imm; M[addr] = R[rs2][7:0]
-                        if (DEBUG_MODE) {
-                            std::cout << "SB: dmem[0x" << std::hex << addr << std::dec << "] = 0x" << std::hex << dmem_wdata << std::dec 
-                            << " (real addr >> 2: 0x" << std::hex << word_addr << std::dec << ")"
-                            << std::endl;
-                        }
-                        dmem[word_addr] = (uint32_t)(dmem_wdata & 0x000000FF);
-                    } else {
-                        std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << std::endl;
-                        throw std::runtime_error("Illegal function");
-                    }
-                } else {
-                    std::cerr << "Error: Illegal address: word_addr = 0x" << std::hex << word_addr << std::dec << std::endl;
-                    throw std::runtime_error("Illegal address");
-                }
-            } else {
+        case 0x23: {  // Store
+            if (rs1 >= REGISTER_LIMIT || rs2 >= REGISTER_LIMIT) {
                 std::cerr << "Error: Illegal register: rs1 = " << (int)rs1 << ", rs2 = " << (int)rs2 << std::endl;
                 throw std::runtime_error("Illegal register");
             }
-            break;
+            std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << std::endl;
+            throw std::runtime_error("Illegal function");
         }
-        
-        case 0x67: {  // I-Type: JALR
-            if (DEBUG_MODE) {
-                std::cout << "JALR: rd = x" << (int)rd 
-                << ", rs1 = x" << (int)rs1 
-                << ", imm_i = " << imm_i << std::endl;
-            }
-            
-            if (funct3 == 0x0) {
-                if (rd < REGISTER_LIMIT && rs1 < REGISTER_LIMIT) {
-                    next_pc = (registers[rs1] + imm_i) & 0xFFFFFFFE;  // Clear LSB
-                    registers[rd] = pc_plus4;
-                    // next_pc = target;
-                } else {
-                    std::cerr << "Error: Illegal register: rd = " << (int)rd << ", rs1 = " << (int)rs1 << std::endl;
-                    // throw std::runtime_error("Illegal register");
-                }
-            }
-            if (DEBUG_MODE) {
-                std::cout << "JALR: pc_new = 0x" << std::hex << next_pc << std::dec 
-                << ", pc_saved pc + 4 = 0x" << std::hex << pc_plus4 << std::dec 
-                << " in register x" << (int)rd << std::endl;
-            }
-            break;
-        }
-        
-        default: {
+        case 0x67:  // JALR: illegal registers are reported, PC still advances
+            std::cerr << "Error: Illegal register: rd = " << (int)rd << ", rs1 = " << (int)rs1 << std::endl;
+            return;
+        default:
+            return;
+    }
+    std::cerr << "Error: Illegal function: funct3 = 0b" << std::bitset<3>(funct3) << ", funct7 = 0b" << std::bitset<7>(funct7) << std::endl;
+    throw std::runtime_error("Illegal function");
+}
+
+
+// ---- Instruction handlers ----
+// One small inline function per decoded op, shared by executeDecoded and the
+// interpret() dispatch core. Handlers do not touch pc and do not re-zero x0.
+
+inline void GoldenModelCPU::opAdd(const DecodedInstruction& d) {
+    registers[d.rd] = registers[d.rs1] + registers[d.rs2];
+}
+
+inline void GoldenModelCPU::opAddi(const DecodedInstruction& d) {
+    registers[d.rd] = registers[d.rs1] + d.imm;
+}
+
+inline void GoldenModelCPU::opLui(const DecodedInstruction& d) {
+    registers[d.rd] = (uint32_t)d.imm;
+}
+
+inline void GoldenModelCPU::opLw(const DecodedInstruction& d) {
+    // Read the aligned 32-bit word (addr[1:0] ignored like the RTL), unmapped addresses read zero
+    uint32_t addr = registers[d.rs1] + d.imm;
+    uint32_t value;
+    bus.readWord(addr, value);
+    registers[d.rd] = value;
+}
+
+inline void GoldenModelCPU::opLbu(const DecodedInstruction& d) {
+    //Load Byte Unsigned: Loads 8 bits from memory and zero-extends them to 32 bits.
+    //addr = R[rs1] + imm; R[rd] = {24'b0, M[addr][7:0]}
+    uint32_t addr = registers[d.rs1] + d.imm;
+    uint8_t value;
+    bus.readByte(addr, value);
+    registers[d.rd] = value;
+}
+
+inline void GoldenModelCPU::opSw(const DecodedInstruction& d) {
+    // Store full 32-bit word, unmapped addresses drop it like the RTL
+    uint32_t addr = registers[d.rs1] + d.imm;
+    bus.writeWord(addr, registers[d.rs2]);
+}
+
+inline void GoldenModelCPU::opSb(const DecodedInstruction& d) {
+    // Store Byte: Stores the lowest 8 bits of a register into memory.
+    // addr = R[rs1] + imm; M[addr] = R[rs2][7:0], the other three lanes keep their value
+    uint32_t addr = registers[d.rs1] + d.imm;
+    bus.writeByte(addr, (uint8_t)(registers[d.rs2] & 0x000000FF));
+}
+
+inline uint32_t GoldenModelCPU::opJalr(const DecodedInstruction& d) {
+    uint32_t next_pc = (registers[d.rs1] + d.imm) & 0xFFFFFFFE;  // Clear LSB
+    registers[d.rd] = pc + 4;
+    return next_pc;
+}
+
+
+// Execute the decoded instruction at the current PC and return the next PC.
+// Shared by the single-step interpreter and the basic-block engine; pc is not updated here.
+template <class TracePolicy>
+inline uint32_t GoldenModelCPU::executeDecoded(const DecodedInstruction& d) {
+    // Initialize next PC to PC+4 (sequential execution)
+    uint32_t next_pc = pc + 4;
+
+    TracePolicy::beforeExecute(*this, d);
+    
+    // Dispatch on the pre-decoded handler index
+    switch (d.op) {
+        case OP_ADD:     opAdd(d); break;           // R-Type: ADD
+        case OP_ADDI:    opAddi(d); break;          // I-Type: ADDI
+        case OP_LUI:     opLui(d); break;           // U-Type: LUI
+        case OP_LW:      opLw(d); break;            // I-Type: Load word
+        case OP_LBU:     opLbu(d); break;           // I-Type: Load byte unsigned
+        case OP_SW:      opSw(d); break;            // S-Type: Store word
+        case OP_SB:      opSb(d); break;            // S-Type: Store byte
+        case OP_JALR:    next_pc = opJalr(d); break; // I-Type: JALR
+        case OP_ILLEGAL: executeIllegal(imem[pc >> 2]); break;
+        default:
             // Unknown instruction - treat as NOP (just increment PC)
             break;
+    }
+
+    TracePolicy::afterExecute(*this, d, next_pc);
+    
+    return next_pc;
+}
+
+
+// Interpreter core: run up to `cycles` instructions without tracing.
+// Dispatch is direct-threaded (one indirect jump at the end of every handler,
+// indexed by the pre-decoded op) when GOLDEN_MODEL_THREADED_DISPATCH is set,
+// otherwise a portable switch loop. With Checked = false the stop conditions
+// compile away and exceptions propagate, which is what interpret() uses;
+// run() instantiates it with Checked = true.
+template <bool Checked>
+void GoldenModelCPU::dispatch(uint64_t cycles, const StopCondition& stop, RunResult& result) {
+    result.reason = StopReason::CycleLimit;
+    result.retired = 0;
+    result.error.clear();
+    if (cycles == 0) return;
+
+    const DecodedInstruction* d;
+    uint64_t remaining = cycles;
+    const uint32_t watch_word = stop.watch_addr >> 2;
+
+// Fetch the decoded instruction at pc (bounds-checked like executeInstruction)
+#define GM_FETCH()                                                                          \
+    do {                                                                                    \
+        if (Checked && stop.halt_enabled && pc == stop.halt_pc) {                           \
+            result.reason = StopReason::HaltAddress;                                        \
+            goto stopped;                                                                   \
+        }                                                                                   \
+        d = &fetchDecoded(pc >> 2);                                                         \
+    } while (0)
+
+// Retire the current instruction and stop for `why`
+#define GM_STOP_AFTER(why)                                                                  \
+    do {                                                                                    \
+        --remaining;                                                                        \
+        result.reason = why;                                                                \
+        goto stopped;                                                                       \
+    } while (0)
+
+// Store hits the watched word (evaluated before the store executes)
+#define GM_WATCH_HIT()                                                                      \
+    (Checked && stop.watch_enabled && ((registers[d->rs1] + d->imm) >> 2) == watch_word)
+
+    try {
+#if GOLDEN_MODEL_THREADED_DISPATCH
+        // Indexed by DecodedOp, must follow the enum order
+        static const void* const handlers[OP_COUNT] = {
+            &&do_nop, &&do_add, &&do_addi, &&do_lui, &&do_lw,
+            &&do_lbu, &&do_sw, &&do_sb, &&do_jalr, &&do_illegal
+        };
+
+// Retire the current instruction and jump straight to the next handler
+#define GM_NEXT()                                                                           \
+    do {                                                                                    \
+        if (--remaining == 0) goto done;                                                    \
+        GM_FETCH();                                                                         \
+        goto *handlers[d->op];                                                              \
+    } while (0)
+
+        GM_FETCH();
+        goto *handlers[d->op];
+
+    do_nop:     pc += 4; GM_NEXT();
+    do_add:     opAdd(*d); registers[0] = 0; pc += 4; GM_NEXT();
+    do_addi:    opAddi(*d); registers[0] = 0; pc += 4; GM_NEXT();
+    do_lui:     opLui(*d); pc += 4; GM_NEXT();
+    do_lw:      opLw(*d); registers[0] = 0; pc += 4; GM_NEXT();
+    do_lbu:     opLbu(*d); registers[0] = 0; pc += 4; GM_NEXT();
+    do_sw: {
+        bool hit = GM_WATCH_HIT();
+        opSw(*d); pc += 4;
+        if (hit) GM_STOP_AFTER(StopReason::WatchedStore);
+        GM_NEXT();
+    }
+    do_sb: {
+        bool hit = GM_WATCH_HIT();
+        opSb(*d); pc += 4;
+        if (hit) GM_STOP_AFTER(StopReason::WatchedStore);
+        GM_NEXT();
+    }
+    do_jalr: {
+        uint32_t jalr_pc = pc;
+        pc = opJalr(*d); registers[0] = 0;
+        if (Checked && stop.stop_on_self_loop && pc == jalr_pc) GM_STOP_AFTER(StopReason::SelfLoop);
+        GM_NEXT();
+    }
+    do_illegal: executeIllegal(imem[pc >> 2]); registers[0] = 0; pc += 4; GM_NEXT();
+
+    done:
+#undef GM_NEXT
+#else
+        for (;;) {
+            GM_FETCH();
+            switch (d->op) {
+                case OP_ADD:     opAdd(*d); pc += 4; break;
+                case OP_ADDI:    opAddi(*d); pc += 4; break;
+                case OP_LUI:     opLui(*d); pc += 4; break;
+                case OP_LW:      opLw(*d); pc += 4; break;
+                case OP_LBU:     opLbu(*d); pc += 4; break;
+                case OP_SW:
+                case OP_SB: {
+                    bool hit = GM_WATCH_HIT();
+                    if (d->op == OP_SW) opSw(*d);
+                    else opSb(*d);
+                    pc += 4;
+                    if (hit) GM_STOP_AFTER(StopReason::WatchedStore);
+                    break;
+                }
+                case OP_JALR: {
+                    uint32_t jalr_pc = pc;
+                    pc = opJalr(*d);
+                    registers[0] = 0;
+                    if (Checked && stop.stop_on_self_loop && pc == jalr_pc) GM_STOP_AFTER(StopReason::SelfLoop);
+                    break;
+                }
+                case OP_ILLEGAL: executeIllegal(imem[pc >> 2]); pc += 4; break;
+                default:         pc += 4; break;
+            }
+            registers[0] = 0;
+            if (--remaining == 0) break;
         }
+#endif
+    stopped:
+        result.retired = cycles - remaining;
+    } catch (const std::exception& e) {
+        if (!Checked) throw;
+        // The faulting instruction did not retire; pc still points at it
+        result.reason = StopReason::Exception;
+        result.retired = cycles - remaining;
+        result.error = e.what();
     }
+#undef GM_WATCH_HIT
+#undef GM_STOP_AFTER
+#undef GM_FETCH
+}
+
+
+// Run up to `cycles` instructions with the interpreter core, returns retired count
+uint64_t GoldenModelCPU::interpret(uint64_t cycles) {
+    RunResult result;
+    dispatch<false>(cycles, StopCondition(), result);
+    return result.retired;
+}
+
+
+// Run up to max_cycles instructions in one tight loop, stopping early on any
+// enabled condition in `stop` or on an exception (which is caught and reported)
+RunResult GoldenModelCPU::run(uint64_t max_cycles, const StopCondition& stop) {
+    RunResult result;
+    dispatch<true>(max_cycles, stop, result);
+    return result;
+}
+
+
+// Name of the dispatch core selected at build time
+const char* GoldenModelCPU::dispatchMode() {
+    return GOLDEN_MODEL_THREADED_DISPATCH ? "threaded" : "switch";
+}
+
+
+// Execute one instruction (single cycle)
+template <class TracePolicy>
+bool GoldenModelCPU::executeInstruction() {
+    // Fetch pre-decoded instruction (throws when the PC is out of bounds)
+    uint32_t word_index = pc >> 2;
+    const DecodedInstruction& d = fetchDecoded(word_index);
+
+    TracePolicy::fetch(*this, imem[word_index]);
     
     // Update PC
-    pc = next_pc;
+    pc = executeDecoded<TracePolicy>(d);
     
     // Ensure x0 is always zero
     registers[0] = 0;
@@ -368,6 +664,140 @@ bool GoldenModelCPU::executeInstruction() {
     return true;
 }
 
+template bool GoldenModelCPU::executeInstruction<NoTrace>();
+template bool GoldenModelCPU::executeInstruction<DebugTrace>();
+template bool GoldenModelCPU::executeInstruction<RetireTrace>();
+
+
+// RetireTrace: build the record from the state right after execution, while
+// pc still points at the retiring instruction
+void RetireTrace::afterExecute(const GoldenModelCPU& cpu, const DecodedInstruction& d, uint32_t next_pc) {
+    (void)next_pc;
+    RetireRecord& record = *cpu.retire_record;
+    record = RetireRecord();
+    record.pc = cpu.pc;
+    record.instr = cpu.imem[cpu.pc >> 2];
+
+    switch (d.op) {
+        case OP_ADD:
+        case OP_ADDI:
+        case OP_LUI:
+        case OP_LW:
+        case OP_LBU:
+        case OP_JALR:
+            if (d.rd != 0) {
+                record.rd = d.rd;
+                record.rd_wdata = cpu.registers[d.rd];
+            }
+            break;
+        case OP_SW:
+            record.mem_addr = cpu.registers[d.rs1] + (uint32_t)d.imm;
+            record.mem_wdata = cpu.registers[d.rs2];
+            record.mem_wstrb = 0xF;
+            break;
+        case OP_SB: {
+            uint32_t lane = (cpu.registers[d.rs1] + (uint32_t)d.imm) & 3;
+            record.mem_addr = cpu.registers[d.rs1] + (uint32_t)d.imm;
+            record.mem_wdata = (cpu.registers[d.rs2] & 0xFF) << (8 * lane);
+            record.mem_wstrb = (uint8_t)(1u << lane);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+
+// Commit-log execution: one record per retired instruction
+size_t GoldenModelCPU::retire(RetireRecord* records, size_t count) {
+    size_t retired = 0;
+    for (; retired < count; retired++) {
+        retire_record = &records[retired];
+        executeInstruction<RetireTrace>();
+    }
+    retire_record = nullptr;
+    return retired;
+}
+
+
+// Execute one instruction, with the verbose trace when DEBUG_MODE is set
+bool GoldenModelCPU::executeInstruction() {
+    if (DEBUG_MODE) {
+        return executeInstruction<DebugTrace>();
+    }
+    return executeInstruction<NoTrace>();
+}
+
+
+// Translate the basic block starting at entry_pc into a micro-op sequence.
+// A block runs up to and including the first JALR (the only control-flow
+// instruction in miniRV) or an illegal encoding, which may not return.
+BasicBlock* GoldenModelCPU::translateBlock(uint32_t entry_pc) {
+    BasicBlock& block = block_cache[entry_pc];
+    block.entry_pc = entry_pc;
+    block.ops.clear();
+    block.next_block = nullptr;
+
+    for (uint32_t word_index = entry_pc >> 2; word_index < (imem.size() >> 2); word_index++) {
+        DecodedInstruction d = fetchDecoded(word_index);
+
+        // Writes to x0 have no effect, so they become NOPs and the block
+        // body never has to re-zero x0.
+        if ((d.op == OP_ADD || d.op == OP_ADDI || d.op == OP_LW || d.op == OP_LBU) && d.rd == 0) {
+            d.op = OP_NOP;
+        }
+        block.ops.push_back(d);
+
+        if (d.op == OP_JALR || d.op == OP_ILLEGAL || block.ops.size() >= MAX_BLOCK_LENGTH) {
+            break;
+        }
+    }
+    return &block;
+}
+
+
+// Find the cached block at entry_pc, translating it on a miss
+BasicBlock* GoldenModelCPU::lookupBlock(uint32_t entry_pc) {
+    fetchDecoded(entry_pc >> 2);  // Bounds check
+    std::unordered_map<uint32_t, BasicBlock>::iterator it = block_cache.find(entry_pc);
+    return (it != block_cache.end()) ? &it->second : translateBlock(entry_pc);
+}
+
+
+// Drop all translated blocks (imem changed)
+void GoldenModelCPU::flushBlocks() {
+    block_cache.clear();
+}
+
+
+// Run up to `cycles` instructions one basic block per dispatch.
+// A block is cut short when the cycle budget ends inside it, so the
+// architectural state after N cycles matches the interpreter exactly.
+uint64_t GoldenModelCPU::runBlocks(uint64_t cycles) {
+    uint64_t retired = 0;
+    BasicBlock* block = nullptr;
+    while (retired < cycles) {
+        // Follow the chain from the previous block when it exits to the same
+        // place again (loops, the final self-jump), otherwise look it up.
+        BasicBlock* next = (block && block->next_block && block->next_block->entry_pc == pc)
+                           ? block->next_block : lookupBlock(pc);
+        if (block) block->next_block = next;
+        block = next;
+
+        uint64_t count = block->ops.size();
+        if (count > cycles - retired) count = cycles - retired;
+
+        const DecodedInstruction* op = block->ops.data();
+        for (uint64_t i = 0; i < count; i++) {
+            pc = executeDecoded<NoTrace>(op[i]);
+        }
+        // Only the terminating JALR (or an illegal op) can have written x0
+        registers[0] = 0;
+        retired += count;
+    }
+    return retired;
+}
+
 
 // Clock cycle: execute one instruction
 void GoldenModelCPU::clockCycle() {
@@ -381,8 +811,18 @@ void GoldenModelCPU::clockCycle() {
 
 // Run CPU for N cycles
 void GoldenModelCPU::runCycles(int cycles) {
-    for (int i = 0; i < cycles; i++) {
-        clockCycle();
+    // Debug runs step through clockCycle to keep the per-instruction trace
+    if (DEBUG_MODE || reset) {
+        for (int i = 0; i < cycles; i++) {
+            clockCycle();
+        }
+        return;
+    }
+    if (cycles <= 0) return;
+    if (engine == ExecutionEngine::BasicBlock) {
+        runBlocks(cycles);
+    } else {
+        interpret(cycles);
     }
 }
 
@@ -392,7 +832,7 @@ void GoldenModelCPU::printState() {
     std::cout << "CPU State:\n";
     std::cout << "  PC: 0x" << std::hex << std::setfill('0') << std::setw(8) << pc << std::dec << "\n";
     std::cout << "  Registers:\n";
-    for (int i = 0; i < REGISTER_LIMIT; i++) {
+    for (size_t i = 0; i < REGISTER_LIMIT; i++) {
         std::cout << "\t x" << i << ": 0x" << std::hex << std::setfill('0') << std::setw(8) 
                     << registers[i] << std::dec;
         if (i % 4 == 3) std::cout << "\n";
@@ -422,3 +862,221 @@ void GoldenModelCPU::readMem() {
                   << dmem[i] << std::dec << std::endl;
     }
 }
+
+
+// CpuSnapshot file format (host byte order):
+//   "MRVSNAP1", cycle (u64), pc (u32), clock/reset (u8 each, 2 pad bytes),
+//   registers (16 x u32), decoded_words (u32), then for imem and dmem:
+//   size in bytes (u64), page count (u32), and per page its index (u32)
+//   followed by PAGE_SIZE bytes. All-zero pages are not written.
+
+// Version 2 adds the device state; version 1 files still load, with the
+// devices in their reset state
+static const char SNAPSHOT_MAGIC[8] = {'M', 'R', 'V', 'S', 'N', 'A', 'P', '2'};
+static const char SNAPSHOT_MAGIC_V1[8] = {'M', 'R', 'V', 'S', 'N', 'A', 'P', '1'};
+
+static_assert(sizeof(CpuSnapshot::registers) == sizeof(GoldenModelCPU::registers),
+              "CpuSnapshot register file must match GoldenModelCPU");
+
+
+DeviceSnapshot::DeviceSnapshot()
+    : vga(), exited(false), exit_code(0) {
+}
+
+
+void DeviceSnapshot::capture(VgaFramebuffer& vga_device, const ExitPort& exit_port) {
+    vga = vga_device.snapshot();
+    exited = exit_port.exited();
+    exit_code = exit_port.code();
+}
+
+
+void DeviceSnapshot::apply(VgaFramebuffer& vga_device, ExitPort& exit_port) const {
+    if (vga.size() == VgaFramebuffer::BYTES) {
+        vga_device.restore(vga);
+    } else {
+        vga_device.clear();     // Never captured (version 1 snapshot file)
+    }
+    exit_port.restore(exited, exit_code);
+}
+
+
+CpuSnapshot::CpuSnapshot()
+    : cycle(0), clock(false), reset(false), pc(0), decoded_words(0) {
+    memset(registers, 0, sizeof(registers));
+}
+
+
+template <class T>
+static void writePod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+template <class T>
+static bool readPod(std::istream& in, T& value) {
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+
+static bool isZeroPage(const uint8_t* page) {
+    static const uint8_t zero[SparseMemory::PAGE_SIZE] = {};
+    return memcmp(page, zero, SparseMemory::PAGE_SIZE) == 0;
+}
+
+
+static void writeMemorySnapshot(std::ostream& out, const MemorySnapshot& mem) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < mem.pageCount(); i++) {
+        if (!isZeroPage(mem.pageData(i))) count++;
+    }
+    writePod(out, (uint64_t)mem.size());
+    writePod(out, count);
+    for (size_t i = 0; i < mem.pageCount(); i++) {
+        if (isZeroPage(mem.pageData(i))) continue;
+        writePod(out, mem.pageIndex(i));
+        out.write(reinterpret_cast<const char*>(mem.pageData(i)), SparseMemory::PAGE_SIZE);
+    }
+}
+
+
+static bool readMemorySnapshot(std::istream& in, MemorySnapshot& mem) {
+    uint64_t size;
+    uint32_t count;
+    if (!readPod(in, size) || !readPod(in, count)) return false;
+
+    mem.reset((size_t)size);
+    std::vector<uint8_t> page(SparseMemory::PAGE_SIZE);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index;
+        if (!readPod(in, index) ||
+            !in.read(reinterpret_cast<char*>(page.data()), SparseMemory::PAGE_SIZE)) {
+            return false;
+        }
+        mem.addPage(index, page.data());
+    }
+    return true;
+}
+
+
+bool CpuSnapshot::save(const std::string& filename) const {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot create file " << filename << std::endl;
+        return false;
+    }
+
+    out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    writePod(out, cycle);
+    writePod(out, pc);
+    uint8_t flags[4] = {(uint8_t)clock, (uint8_t)reset, 0, 0};
+    out.write(reinterpret_cast<const char*>(flags), sizeof(flags));
+    out.write(reinterpret_cast<const char*>(registers), sizeof(registers));
+    writePod(out, decoded_words);
+    writeMemorySnapshot(out, imem);
+    writeMemorySnapshot(out, dmem);
+    writeMemorySnapshot(out, devices.vga);
+    uint8_t exited = devices.exited;
+    writePod(out, exited);
+    writePod(out, devices.exit_code);
+
+    return out.good();
+}
+
+
+bool CpuSnapshot::load(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint8_t flags[4];
+    bool valid = in.read(magic, sizeof(magic)) &&
+                 (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0 ||
+                  memcmp(magic, SNAPSHOT_MAGIC_V1, sizeof(magic)) == 0) &&
+                 readPod(in, cycle) && readPod(in, pc) &&
+                 in.read(reinterpret_cast<char*>(flags), sizeof(flags)) &&
+                 in.read(reinterpret_cast<char*>(registers), sizeof(registers)) &&
+                 readPod(in, decoded_words) &&
+                 readMemorySnapshot(in, imem) && readMemorySnapshot(in, dmem);
+
+    devices = DeviceSnapshot();
+    if (valid && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0) {
+        uint8_t exited;
+        valid = readMemorySnapshot(in, devices.vga) && readPod(in, exited) && readPod(in, devices.exit_code);
+        devices.exited = exited != 0;
+    }
+    if (!valid) {
+        std::cerr << "Error: Invalid snapshot file " << filename << std::endl;
+        return false;
+    }
+    clock = flags[0] != 0;
+    reset = flags[1] != 0;
+    return true;
+}
+
+
+// CheckpointLog implementation
+
+CheckpointLog::CheckpointLog(uint64_t interval, size_t capacity)
+    : every(interval ? interval : 1), capacity(capacity ? capacity : 1) {
+}
+
+
+bool CheckpointLog::maybeCheckpoint(GoldenModelCPU& cpu, uint64_t cycle) {
+    if (cycle % every != 0) {
+        return false;
+    }
+    checkpoint(cpu, cycle);
+    return true;
+}
+
+
+void CheckpointLog::checkpoint(GoldenModelCPU& cpu, uint64_t cycle) {
+    if (!checkpoints.empty() && checkpoints.back().cycle == cycle) {
+        checkpoints.pop_back();
+    }
+    checkpoints.push_back(cpu.snapshot(cycle));
+    while (checkpoints.size() > capacity) {
+        checkpoints.pop_front();
+    }
+}
+
+
+const CpuSnapshot* CheckpointLog::nearest(uint64_t cycle) const {
+    for (size_t i = checkpoints.size(); i > 0; i--) {
+        if (checkpoints[i - 1].cycle <= cycle) {
+            return &checkpoints[i - 1];
+        }
+    }
+    return nullptr;
+}
+
+
+RunResult CheckpointLog::run(GoldenModelCPU& cpu, uint64_t start_cycle, uint64_t max_cycles,
+                             const StopCondition& stop) {
+    RunResult total;
+    total.reason = StopReason::CycleLimit;
+    total.retired = 0;
+
+    uint64_t cycle = start_cycle;
+    maybeCheckpoint(cpu, cycle);
+
+    while (total.retired < max_cycles) {
+        uint64_t batch = every - cycle % every;
+        if (batch > max_cycles - total.retired) batch = max_cycles - total.retired;
+
+        RunResult result = cpu.run(batch, stop);
+        total.retired += result.retired;
+        cycle += result.retired;
+        if (result.reason != StopReason::CycleLimit) {
+            total.reason = result.reason;
+            total.error = result.error;
+            break;
+        }
+        maybeCheckpoint(cpu, cycle);
+    }
+    return total;
+}
@@ -3,12 +3,132 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include "golden_model_memory.h"
+#include "halt_detector.h"
+#include "memory_fabric.h"
+#include "program_image.h"
+#include "uart_device.h"
+#include "vga_device.h"
 
 // Global cycle limit
 extern int CYCLE_LIMIT;
 extern bool DEBUG_MODE;
 extern std::string INSTRUCTION_MEMORY_FILE;
+
+// Handler index of a pre-decoded instruction (opcode + funct3/funct7 resolved)
+enum DecodedOp : uint8_t {
+    OP_NOP = 0,     // Unknown opcode or ignored encoding: just increment PC
+    OP_ADD,
+    OP_ADDI,
+    OP_LUI,
+    OP_LW,
+    OP_LBU,
+    OP_SW,
+    OP_SB,
+    OP_JALR,
+    OP_ILLEGAL,     // Illegal funct/register: handled by the slow error path
+    OP_COUNT
+};
+
+// Instruction with its fields already unpacked, stored next to imem
+struct DecodedInstruction {
+    uint8_t op;     // DecodedOp handler index
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    int32_t imm;    // imm_i, imm_s or imm_u, selected by op
+};
+
+class GoldenModelCPU;
+struct CpuSnapshot;
+
+// Why GoldenModelCPU::run returned
+enum class StopReason {
+    CycleLimit,     // max_cycles instructions retired
+    HaltAddress,    // PC reached StopCondition::halt_pc (not executed)
+    SelfLoop,       // A JALR jumped to its own address
+    WatchedStore,   // A store wrote the word containing StopCondition::watch_addr
+    Exception       // Execution threw; see RunResult::error
+};
+
+// Early-stop conditions for GoldenModelCPU::run (all disabled by default)
+struct StopCondition {
+    bool     halt_enabled;
+    uint32_t halt_pc;
+    bool     stop_on_self_loop;
+    bool     watch_enabled;
+    uint32_t watch_addr;    // Byte address, matched at word granularity
+
+    StopCondition()
+        : halt_enabled(false), halt_pc(0), stop_on_self_loop(false),
+          watch_enabled(false), watch_addr(0) {}
+};
+
+// Outcome of GoldenModelCPU::run
+struct RunResult {
+    StopReason  reason;
+    uint64_t    retired;    // Instructions retired by this call
+    std::string error;      // Exception message when reason == StopReason::Exception
+};
+
+// Trace policies for executeInstruction<TracePolicy>.
+// NoTrace hooks are empty and inline, so release instantiations carry no
+// debug branches or iostream code; DebugTrace prints the DEBUG_MODE trace.
+struct NoTrace {
+    static void fetch(const GoldenModelCPU&, uint32_t) {}
+    static void beforeExecute(const GoldenModelCPU&, const DecodedInstruction&) {}
+    static void afterExecute(const GoldenModelCPU&, const DecodedInstruction&, uint32_t) {}
+};
+
+struct DebugTrace {
+    static void fetch(const GoldenModelCPU& cpu, uint32_t instr);
+    static void beforeExecute(const GoldenModelCPU& cpu, const DecodedInstruction& d);
+    static void afterExecute(const GoldenModelCPU& cpu, const DecodedInstruction& d, uint32_t next_pc);
+};
+
+// Retirement record of one instruction, as emitted by GoldenModelCPU::retire
+// and by the retire_* ports of miniRV.sv, so co-simulation can diff the two
+// streams instead of the whole state. Fields that do not apply are zero
+// (rd = 0: no register write, mem_wstrb = 0: no store), so equal records are
+// byte-identical and a batch compares with one memcmp.
+struct RetireRecord {
+    uint32_t pc;
+    uint32_t instr;
+    uint32_t rd_wdata;      // Value written to rd
+    uint32_t mem_addr;      // Store byte address
+    uint32_t mem_wdata;     // Store data on the bus lanes (SB shifted to its byte)
+    uint8_t  rd;
+    uint8_t  mem_wstrb;     // Byte lanes written, like dmem_wstrb
+    uint8_t  reserved[2];
+
+    RetireRecord() { memset(this, 0, sizeof(*this)); }
+};
+
+// RetireTrace: fills GoldenModelCPU::retire_record after each instruction
+struct RetireTrace {
+    static void fetch(const GoldenModelCPU&, uint32_t) {}
+    static void beforeExecute(const GoldenModelCPU&, const DecodedInstruction&) {}
+    static void afterExecute(const GoldenModelCPU& cpu, const DecodedInstruction& d, uint32_t next_pc);
+};
+
+// Cached basic block: straight-line micro-ops ending at a JALR
+struct BasicBlock {
+    uint32_t entry_pc;
+    std::vector<DecodedInstruction> ops;
+    BasicBlock* next_block;     // Block the last exit jumped to (chaining), may be null
+};
+
+// Execution engine used by runCycles
+enum class ExecutionEngine {
+    Interpreter,    // One dispatch per instruction (clockCycle loop)
+    BasicBlock      // One dispatch per cached basic block
+};
+
 class GoldenModelCPU {
 private:
     static constexpr size_t REGISTER_LIMIT = 16;
@@ -20,25 +140,98 @@ public:
     uint32_t pc;              // Program Counter
     uint32_t registers[REGISTER_LIMIT];        // 16 registers (x0-x15)
     
-    // Instruction memory and data memory
-    static constexpr size_t IMEM_SIZE = 128 * 1024; 
-    static constexpr size_t DMEM_SIZE = 128 * 1024;
+    // Default instruction and data memory sizes in words: 16 MiB each,
+    // the same 24-bit byte address space as instruction_fetch.sv
+    static constexpr size_t IMEM_SIZE = 1 << 22;
+    static constexpr size_t DMEM_SIZE = 1 << 22;
     
-    uint32_t imem[IMEM_SIZE];  // Instruction memory (word-addressable)
-    uint32_t dmem[DMEM_SIZE];  // Data memory (word-addressable, 32-bit data width)
+    SparseMemory imem;  // Instruction memory (imem[i] reads word i)
+    SparseMemory dmem;  // Data memory (byte-addressable, little-endian, 32-bit data width)
+
+    // Data address space seen by loads and stores: dmem as RAM at address 0,
+    // plus any MMIO devices mapped with bus.mapDevice(). Snapshots include
+    // the state of the devices below (see DeviceSnapshot).
+    MemoryFabric bus;
+
+    // Devices mapped on bus by the constructor
+    VgaFramebuffer vga;     // VgaFramebuffer::BASE
+    UartDevice uart;        // UartDevice::BASE, output discarded until uart.setOutput()
+    ExitPort exit_port;     // ExitPort::BASE, cleared by resetCPU()
+
+    // Pre-decoded copy of imem, filled by loadImage. It only covers the
+    // loaded program; words above it are zero, which decodes to a NOP.
+    std::vector<DecodedInstruction> decoded;
+
+    // Engine used by runCycles (the interpreter by default)
+    ExecutionEngine engine;
     
-    // Constructor
-    GoldenModelCPU();
+    // Constructor: memory sizes in 32-bit words
+    explicit GoldenModelCPU(size_t imem_words = IMEM_SIZE, size_t dmem_words = DMEM_SIZE);
     
-    // Load instructions from hex file (Logisim format)
+    // Load a program file (Logisim hex, raw .bin or ELF, see ProgramImage)
+    // into both imem and dmem, through the program image cache
+    bool loadProgram(const std::string& filename);
+
+    // Load instructions from hex file (Logisim format); same as loadProgram
     bool loadHexFile(const std::string& filename);
+
+    // Copy an already parsed image into imem and dmem and decode it
+    void loadImage(const ProgramImage& image);
     
+    // Decode a raw instruction word into its handler index and fields
+    static DecodedInstruction decodeInstruction(uint32_t instr);
+
+    // Re-decode one imem word after it has been written
+    void invalidateDecoded(uint32_t word_index);
+
+    // Re-decode imem words [first_word, end_word) after a bulk write
+    void invalidateDecoded(uint32_t first_word, uint32_t end_word);
+
     // Reset CPU
     void resetCPU();
+
+    // Zero imem, dmem and the framebuffer (touching only dirty pages) and drop decoded state
+    void clearMemory();
+
+    // Capture pc, registers and both memories. Memory pages are shared with
+    // the snapshot copy-on-write, so this costs O(dirty pages) and later
+    // writes copy only the pages they touch. `cycle` is the caller's cycle
+    // count, kept with the snapshot for CheckpointLog.
+    CpuSnapshot snapshot(uint64_t cycle = 0);
+
+    // Return to a snapshot's state. imem is only re-decoded if it differs.
+    void restore(const CpuSnapshot& snap);
     
-    // Execute one instruction (single cycle)
+    // Execute one instruction (single cycle), traced by TracePolicy
+    template <class TracePolicy>
+    bool executeInstruction();
+
+    // Execute one instruction, with DebugTrace when DEBUG_MODE is set
     bool executeInstruction();
     
+    // Run up to `cycles` instructions with the interpreter core, returns retired count
+    uint64_t interpret(uint64_t cycles);
+
+    // Execute `count` instructions, writing one RetireRecord each to `records`
+    // (commit-log co-simulation); returns count. An illegal instruction throws
+    // like clockCycle(), with the records before it already filled
+    size_t retire(RetireRecord* records, size_t count);
+
+    // Record being filled by RetireTrace, null outside retire()
+    RetireRecord* retire_record;
+
+    // Run up to max_cycles instructions, stopping early on `stop` or an exception
+    RunResult run(uint64_t max_cycles, const StopCondition& stop = StopCondition());
+
+    // Name of the interpreter dispatch core selected at build time ("threaded" or "switch")
+    static const char* dispatchMode();
+
+    // Run up to `cycles` instructions with the basic-block engine, returns retired count
+    uint64_t runBlocks(uint64_t cycles);
+
+    // Drop all translated basic blocks
+    void flushBlocks();
+    
     // Clock cycle: execute one instruction
     void clockCycle();
     
@@ -53,6 +246,110 @@ public:
     
     // Read data from memory
     void readMem();
+
+private:
+    static constexpr size_t MAX_BLOCK_LENGTH = 256;
+
+    // Translated blocks keyed by entry PC
+    std::unordered_map<uint32_t, BasicBlock> block_cache;
+
+    // Interpreter dispatch loop shared by interpret() and run()
+    template <bool Checked>
+    void dispatch(uint64_t cycles, const StopCondition& stop, RunResult& result);
+
+    // Execute the decoded instruction at pc, returns the next PC
+    template <class TracePolicy>
+    uint32_t executeDecoded(const DecodedInstruction& d);
+
+    // Per-op handlers used by executeDecoded and interpret
+    void opAdd(const DecodedInstruction& d);
+    void opAddi(const DecodedInstruction& d);
+    void opLui(const DecodedInstruction& d);
+    void opLw(const DecodedInstruction& d);
+    void opLbu(const DecodedInstruction& d);
+    void opSw(const DecodedInstruction& d);
+    void opSb(const DecodedInstruction& d);
+    uint32_t opJalr(const DecodedInstruction& d);
+
+    // Translate the block starting at entry_pc and cache it
+    BasicBlock* translateBlock(uint32_t entry_pc);
+
+    // Find the cached block at entry_pc, translating it on a miss
+    BasicBlock* lookupBlock(uint32_t entry_pc);
+
+    // Decoded entry for an imem word, throws when the PC is out of bounds
+    const DecodedInstruction& fetchDecoded(uint32_t word_index) const;
+
+    // Decoded form of a zero word, returned above the loaded program
+    static const DecodedInstruction nop_instruction;
+
+    // Slow path for OP_ILLEGAL: report the error exactly as the decoder saw it
+    void executeIllegal(uint32_t instr);
+};
+
+// State of the MMIO devices a miniRV program can observe: the VGA pixels and
+// the exit port. The UART only produces output and has none to keep. Used by
+// CpuSnapshot and by the testbench's checkpoints of the RTL's devices.
+struct DeviceSnapshot {
+    MemorySnapshot vga;
+    bool exited;
+    uint32_t exit_code;
+
+    DeviceSnapshot();
+
+    void capture(VgaFramebuffer& vga_device, const ExitPort& exit_port);
+    void apply(VgaFramebuffer& vga_device, ExitPort& exit_port) const;
+};
+
+// Complete architectural state of a GoldenModelCPU (see snapshot/restore).
+// save/load use a compact binary file: a header with pc and registers, then
+// only the non-zero pages of imem, dmem and the VGA framebuffer.
+struct CpuSnapshot {
+    uint64_t cycle;
+    bool clock;
+    bool reset;
+    uint32_t pc;
+    uint32_t registers[16];         // x0-x15
+    uint32_t decoded_words;         // Extent of the decoded program in imem
+    MemorySnapshot imem;
+    MemorySnapshot dmem;
+    DeviceSnapshot devices;
+
+    CpuSnapshot();
+
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+};
+
+// Periodic checkpoints of a long run: a snapshot every `interval` cycles,
+// keeping the most recent `capacity` of them. Unchanged pages are shared
+// between checkpoints, so each one costs only the pages written since the
+// previous checkpoint.
+class CheckpointLog {
+public:
+    CheckpointLog(uint64_t interval, size_t capacity);
+
+    // Snapshot cpu if cycle falls on the interval, returns true if it did
+    bool maybeCheckpoint(GoldenModelCPU& cpu, uint64_t cycle);
+
+    // Snapshot cpu unconditionally
+    void checkpoint(GoldenModelCPU& cpu, uint64_t cycle);
+
+    // Latest checkpoint at or before cycle, nullptr if there is none
+    const CpuSnapshot* nearest(uint64_t cycle) const;
+
+    // GoldenModelCPU::run in interval-sized batches starting at cycle
+    // start_cycle, checkpointing at every interval boundary
+    RunResult run(GoldenModelCPU& cpu, uint64_t start_cycle, uint64_t max_cycles,
+                  const StopCondition& stop = StopCondition());
+
+    uint64_t interval() const { return every; }
+    size_t size() const { return checkpoints.size(); }
+
+private:
+    uint64_t every;
+    size_t capacity;
+    std::deque<CpuSnapshot> checkpoints;
 };
 
 #endif // GOLDEN_MODEL_CPU_H
@@ -12,23 +12,23 @@ if [ $# -gt 0 ]; then
     HEX_FILE="$1"
 fi
 
+# Optional snapshot to start from instead of reset
+SNAPSHOT_FILE="$2"
+
 echo "Hex file: $HEX_FILE"
 
 # Create build directory if it doesn't exist
 BUILD_DIR="build"
-echo "Removing build directory: $BUILD_DIR"
-rm -rf "$BUILD_DIR"
-
-echo "Creating build directory: $BUILD_DIR"
 if [ ! -d "$BUILD_DIR" ]; then
+    echo "Creating build directory: $BUILD_DIR"
     mkdir -p "$BUILD_DIR"
 fi
 
 # Compile
 echo "Compiling golden_model main and cpu..."
 g++ -o "$BUILD_DIR/golden_model_cpu" \
-    golden_model_main.cpp golden_model_cpu.cpp \
-    -std=c++11 -Wall
+    golden_model_main.cpp golden_model_cpu.cpp golden_model_memory.cpp memory_fabric.cpp vga_device.cpp uart_device.cpp halt_detector.cpp program_image.cpp \
+    -std=c++11 -Wall -O2
 
 
 # Check if compilation was successful
@@ -39,4 +39,4 @@ fi
 
 # Run with hex file
 echo "Running golden_model_cpu with $HEX_FILE..."
-./"$BUILD_DIR/golden_model_cpu" "$HEX_FILE"
+./"$BUILD_DIR/golden_model_cpu" "$HEX_FILE" $SNAPSHOT_FILE
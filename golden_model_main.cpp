@@ -9,19 +9,34 @@
 #include <stdexcept>
 
 
+// Usage: golden_model_cpu [--am-halt] [hex file] [snapshot file]
+// --am-halt: a spin-loop halt exits with a0 (AM halt(code)) instead of 0
 int main(int argc, char** argv) {
+    std::vector<std::string> args;
+    bool am_halt = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--am-halt") == 0) am_halt = true;
+        else args.push_back(argv[i]);
+    }
+
     std::string hex_file = "logisim-bin/sum.hex";
-    if (argc > 1) {
-        hex_file = argv[1];
+    if (args.size() > 0) {
+        hex_file = args[0];
+    }
+    // Optional CpuSnapshot file (e.g. golden_checkpoint.snap) to start from instead of reset
+    std::string snapshot_file;
+    if (args.size() > 1) {
+        snapshot_file = args[1];
     }
 
     DEBUG_MODE = true;
     
     GoldenModelCPU cpu;
+    cpu.uart.setOutput(stdout);
     
     // Load instructions into instruction memory
     std::cout << "Loading instructions from " << hex_file << " into instruction memory...\n";
-    if (!cpu.loadHexFile(hex_file)) {
+    if (!cpu.loadProgram(hex_file)) {
         return 1;
     }
     for (int i = 0; i < 10; i++) {
@@ -41,6 +56,14 @@ int main(int argc, char** argv) {
     
     // Reset CPU
     cpu.resetCPU();
+    if (!snapshot_file.empty()) {
+        CpuSnapshot snapshot;
+        if (!snapshot.load(snapshot_file)) {
+            return 1;
+        }
+        cpu.restore(snapshot);
+        std::cout << "Restored snapshot " << snapshot_file << " taken at cycle " << snapshot.cycle << "\n";
+    }
     
     // Print initial state
     std::cout << "\nInitial state:\n";
@@ -51,17 +74,44 @@ int main(int argc, char** argv) {
     // cpu.runCycles(100);  // Execute 100 instructions
     std::cout << "--------------------------------\n";
     std::cout << "Executing instructions...\n";
-    for (int i = 0; i < CYCLE_LIMIT; i++) {
-        std::cout << "Cycle " << i+1 << "\n";
-        cpu.clockCycle();
-        cpu.printState();
-        std::cout << "\n";
+    // Stops early once the program finishes (see HaltDetector)
+    HaltDetector halt(&cpu.exit_port, am_halt);
+    int cycles = 0;
+    try {
+        for (; cycles < CYCLE_LIMIT; cycles++) {
+            uint32_t next_instr = cpu.pc < cpu.imem.size() ? cpu.imem[cpu.pc >> 2] : 0;
+            if (halt.observe(cpu.pc, next_instr, cpu.registers)) break;
+            std::cout << "Cycle " << cycles+1 << "\n";
+            cpu.clockCycle();
+            cpu.printState();
+            std::cout << "\n";
+        }
+    } catch (const std::runtime_error& e) {
+        cpu.uart.flush();
+        std::cout << "Execution stopped at cycle " << cycles + 1 << ": " << e.what() << "\n";
+        return 1;
     }
+    cpu.uart.flush();
     std::cout << "--------------------------------\n";
+    if (halt.reason() != HaltReason::None) {
+        std::cout << "Program halted at cycle " << cycles << " (" << HaltDetector::reasonName(halt.reason())
+                  << ", pc = 0x" << std::hex << cpu.pc << ", a0 = 0x" << halt.a0() << std::dec
+                  << "), exit code " << halt.exitCode() << "\n";
+    } else {
+        std::cout << "Cycle limit reached (" << CYCLE_LIMIT << " cycles)\n";
+    }
     
     // Print final state
     std::cout << "\nFinal state:\n";
     cpu.printState();
+
+    // Framebuffer, if the program drew anything
+    FrameDumper vga_dumper(FrameFormat::Ppm, "golden_vga");
+    if (vga_dumper.dump(cpu.vga, cycles)) {
+        std::cout << "VGA frame written to golden_vga_0.ppm\n";
+    }
     
-    return 0;
+    // Non-zero only for a program that exited with a failing code (a
+    // self-loop exits with 0 unless --am-halt)
+    return halt.exitCode() != 0 ? 1 : 0;
 }
@@ -0,0 +1,221 @@
+#include "golden_model_memory.h"
+#include <cstring>
+#include <stdexcept>
+
+// SparseMemory implementation
+
+alignas(4) const uint8_t SparseMemory::zero_page[SparseMemory::PAGE_SIZE] = {};
+
+
+// Constructor: every page starts out mapped to the shared zero page
+SparseMemory::SparseMemory(size_t bytes)
+    : bytes(bytes),
+      page_table((bytes + PAGE_SIZE - 1) >> PAGE_SHIFT, const_cast<uint8_t*>(zero_page)),
+      writable_table(page_table.size(), nullptr) {
+}
+
+
+// Destructor
+SparseMemory::~SparseMemory() {
+    clear();
+    for (size_t i = 0; i < free_pages.size(); i++) {
+        deletePage(free_pages[i]);
+    }
+}
+
+
+// Page storage with its reference count set to 1 (contents undefined)
+uint8_t* SparseMemory::newPage() {
+    uint8_t* page = new uint8_t[PAGE_HEADER + PAGE_SIZE] + PAGE_HEADER;
+    pageRefs(page) = 1;
+    return page;
+}
+
+
+// Page from the free list or the heap, owned by the caller (contents undefined)
+uint8_t* SparseMemory::takePage() {
+    if (free_pages.empty()) {
+        return newPage();
+    }
+    uint8_t* page = free_pages.back();
+    free_pages.pop_back();
+    pageRefs(page) = 1;
+    return page;
+}
+
+
+// Drop this memory's reference; the last owner keeps the page for reuse
+void SparseMemory::releasePage(uint8_t* page) {
+    if (--pageRefs(page) == 0) {
+        free_pages.push_back(page);
+    }
+}
+
+
+// Give a page its own storage on first write: a zeroed page if it was never
+// written, or a private copy if it is shared with a snapshot
+uint8_t* SparseMemory::makeWritable(uint32_t page_index) {
+    uint8_t* shared = page_table[page_index];
+    uint8_t* page;
+    if (shared == zero_page) {
+        page = takePage();
+        memset(page, 0, PAGE_SIZE);
+        dirty_pages.push_back(page_index);
+    } else if (pageRefs(shared) == 1) {
+        // Every snapshot that shared it is gone
+        page = shared;
+    } else {
+        page = takePage();
+        memcpy(page, shared, PAGE_SIZE);
+        releasePage(shared);
+    }
+    page_table[page_index] = page;
+    writable_table[page_index] = page;
+    return page;
+}
+
+
+// Bus-style write of the aligned word containing byte_addr with byte strobes
+void SparseMemory::writeStrobe(uint32_t byte_addr, uint32_t wdata, uint8_t wstrb) {
+    if ((wstrb & 0xF) == 0xF) {
+        writeWord(byte_addr, wdata);
+        return;
+    }
+    uint32_t word_addr = byte_addr & ~3u;
+    for (int lane = 0; lane < 4; lane++) {
+        if (wstrb & (1 << lane)) {
+            writeByte(word_addr + lane, (uint8_t)(wdata >> (8 * lane)));
+        }
+    }
+}
+
+
+// Bulk copy split at page boundaries
+void SparseMemory::writeBlock(uint32_t byte_addr, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t offset = byte_addr & PAGE_MASK;
+        size_t chunk = PAGE_SIZE - offset;
+        if (chunk > length) chunk = length;
+        memcpy(writablePage(byte_addr) + offset, data, chunk);
+        byte_addr += (uint32_t)chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+
+// Zero the whole memory by remapping the dirty pages to the zero page
+void SparseMemory::clear() {
+    for (size_t i = 0; i < dirty_pages.size(); i++) {
+        releasePage(page_table[dirty_pages[i]]);
+        page_table[dirty_pages[i]] = const_cast<uint8_t*>(zero_page);
+        writable_table[dirty_pages[i]] = nullptr;
+    }
+    dirty_pages.clear();
+}
+
+
+// Share every dirty page with the snapshot; the next write to one of them
+// makes a private copy
+MemorySnapshot SparseMemory::snapshot() {
+    MemorySnapshot snap;
+    snap.bytes = bytes;
+    snap.page_indices = dirty_pages;
+    snap.pages.reserve(dirty_pages.size());
+    for (size_t i = 0; i < dirty_pages.size(); i++) {
+        uint8_t* page = page_table[dirty_pages[i]];
+        pageRefs(page)++;
+        snap.pages.push_back(page);
+        writable_table[dirty_pages[i]] = nullptr;
+    }
+    return snap;
+}
+
+
+// Drop the current pages and share the snapshot's instead
+void SparseMemory::restore(const MemorySnapshot& snap) {
+    if (snap.bytes != bytes) {
+        throw std::runtime_error("Snapshot memory size mismatch");
+    }
+    clear();
+    for (size_t i = 0; i < snap.pages.size(); i++) {
+        uint8_t* page = snap.pages[i];
+        pageRefs(page)++;
+        page_table[snap.page_indices[i]] = page;
+        dirty_pages.push_back(snap.page_indices[i]);
+    }
+}
+
+
+bool SparseMemory::matches(const MemorySnapshot& snap) const {
+    if (snap.bytes != bytes || snap.pages.size() != dirty_pages.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < snap.pages.size(); i++) {
+        if (page_table[snap.page_indices[i]] != snap.pages[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// MemorySnapshot implementation
+
+MemorySnapshot::MemorySnapshot() : bytes(0) {}
+
+
+MemorySnapshot::MemorySnapshot(const MemorySnapshot& other)
+    : bytes(other.bytes), page_indices(other.page_indices), pages(other.pages) {
+    for (size_t i = 0; i < pages.size(); i++) {
+        SparseMemory::pageRefs(pages[i])++;
+    }
+}
+
+
+MemorySnapshot& MemorySnapshot::operator=(const MemorySnapshot& other) {
+    if (this != &other) {
+        for (size_t i = 0; i < other.pages.size(); i++) {
+            SparseMemory::pageRefs(other.pages[i])++;
+        }
+        release();
+        bytes = other.bytes;
+        page_indices = other.page_indices;
+        pages = other.pages;
+    }
+    return *this;
+}
+
+
+MemorySnapshot::~MemorySnapshot() {
+    release();
+}
+
+
+// Pages no memory or snapshot refers to any more go back to the heap
+void MemorySnapshot::release() {
+    for (size_t i = 0; i < pages.size(); i++) {
+        if (--SparseMemory::pageRefs(pages[i]) == 0) {
+            SparseMemory::deletePage(pages[i]);
+        }
+    }
+    pages.clear();
+    page_indices.clear();
+}
+
+
+void MemorySnapshot::reset(size_t memory_bytes) {
+    release();
+    bytes = memory_bytes;
+}
+
+
+void MemorySnapshot::addPage(uint32_t page_index, const uint8_t* data) {
+    if (page_index >= (bytes + SparseMemory::PAGE_SIZE - 1) >> SparseMemory::PAGE_SHIFT) {
+        throw std::runtime_error("Snapshot page out of bounds");
+    }
+    uint8_t* page = SparseMemory::newPage();
+    memcpy(page, data, SparseMemory::PAGE_SIZE);
+    page_indices.push_back(page_index);
+    pages.push_back(page);
+}
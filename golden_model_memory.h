@@ -0,0 +1,167 @@
+#ifndef GOLDEN_MODEL_MEMORY_H
+#define GOLDEN_MODEL_MEMORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+class SparseMemory;
+
+// Point-in-time copy of a SparseMemory. Pages are shared with the memory (and
+// other snapshots) by reference count instead of being copied: whoever writes
+// a shared page next gets a private copy of it (copy-on-write), so taking or
+// restoring a snapshot costs O(dirty pages), not O(memory size).
+class MemorySnapshot {
+public:
+    MemorySnapshot();
+    MemorySnapshot(const MemorySnapshot& other);
+    MemorySnapshot& operator=(const MemorySnapshot& other);
+    ~MemorySnapshot();
+
+    // Size in bytes of the memory it was taken from
+    size_t size() const { return bytes; }
+
+    // Captured pages: index into the page table and PAGE_SIZE bytes of data
+    size_t pageCount() const { return pages.size(); }
+    uint32_t pageIndex(size_t i) const { return page_indices[i]; }
+    const uint8_t* pageData(size_t i) const { return pages[i]; }
+
+    // Build a snapshot from serialized pages (CpuSnapshot::load)
+    void reset(size_t memory_bytes);
+    void addPage(uint32_t page_index, const uint8_t* data);
+
+private:
+    friend class SparseMemory;
+
+    size_t bytes;
+    std::vector<uint32_t> page_indices;
+    std::vector<uint8_t*> pages;        // Each holds a reference
+
+    void release();
+};
+
+
+// Sparse byte-addressable little-endian memory for the golden model.
+// The address space is split into 4 KiB pages that are allocated on the first
+// write; untouched pages all map to one shared zero page, so an instance costs
+// a page table plus the pages the program actually uses, whatever its size.
+// Word accesses ignore addr[1:0] like the RTL (word index = addr >> 2) and
+// take a single aligned load/store; byte accesses select the addr[1:0] lane.
+// Reads go through page_table; writes go through writable_table, which only
+// holds pages this memory owns exclusively, so copy-on-write after a
+// snapshot costs the write path nothing beyond the existing null check.
+class SparseMemory {
+public:
+    static constexpr uint32_t PAGE_SHIFT = 12;                 // 4 KiB pages
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+    static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+    // Memory of `bytes` bytes (a multiple of 4), all zero
+    explicit SparseMemory(size_t bytes);
+    ~SparseMemory();
+
+    // Size in bytes
+    size_t size() const { return bytes; }
+
+    // Read the aligned word containing byte_addr (untouched memory and
+    // addresses past the end read as zero, like unmapped MemoryFabric addresses)
+    uint32_t readWord(uint32_t byte_addr) const {
+        if (byte_addr >= bytes) return 0;
+        uint32_t value;
+        memcpy(&value, page_table[byte_addr >> PAGE_SHIFT] + (byte_addr & PAGE_MASK & ~3u), sizeof(value));
+        return toLittleEndian(value);
+    }
+
+    // Read one byte (zero past the end)
+    uint8_t readByte(uint32_t byte_addr) const {
+        if (byte_addr >= bytes) return 0;
+        return page_table[byte_addr >> PAGE_SHIFT][byte_addr & PAGE_MASK];
+    }
+
+    // Writes are not bounds-checked: byte_addr must be below size()
+
+    // Write the aligned word containing byte_addr
+    void writeWord(uint32_t byte_addr, uint32_t value) {
+        value = toLittleEndian(value);
+        memcpy(writablePage(byte_addr) + (byte_addr & PAGE_MASK & ~3u), &value, sizeof(value));
+    }
+
+    // Write one byte, leaving the other lanes of its word untouched
+    void writeByte(uint32_t byte_addr, uint8_t value) {
+        writablePage(byte_addr)[byte_addr & PAGE_MASK] = value;
+    }
+
+    // Bus-style write of the aligned word containing byte_addr: byte lane i is
+    // written with wdata[8*i+7:8*i] when wstrb[i] is set (dmem_wstrb in the RTL)
+    void writeStrobe(uint32_t byte_addr, uint32_t wdata, uint8_t wstrb);
+
+    // Copy length bytes to byte_addr, a page at a time (program loading)
+    void writeBlock(uint32_t byte_addr, const uint8_t* data, size_t length);
+
+    // Array-style word read by word index (imem[i], dmem[i])
+    uint32_t operator[](size_t word_index) const {
+        return word_index < bytes / 4 ? readWord((uint32_t)word_index << 2) : 0;
+    }
+
+    // Zero the whole memory; only the pages written since the last clear are touched
+    void clear();
+
+    // Capture the current contents; the dirty pages become shared
+    MemorySnapshot snapshot();
+
+    // Return to the contents of a snapshot taken from a memory of the same size
+    void restore(const MemorySnapshot& snap);
+
+    // True if the memory still holds exactly the pages of snap (nothing was
+    // written since it was taken or restored)
+    bool matches(const MemorySnapshot& snap) const;
+
+    // Number of pages currently backed by real storage
+    size_t dirtyPages() const { return dirty_pages.size(); }
+
+private:
+    friend class MemorySnapshot;
+
+    static const uint8_t zero_page[PAGE_SIZE];
+
+    size_t bytes;
+    std::vector<uint8_t*> page_table;     // zero_page for pages never written
+    std::vector<uint8_t*> writable_table; // Exclusively owned pages, null otherwise
+    std::vector<uint32_t> dirty_pages;    // Indices of allocated (owned or shared) pages
+    std::vector<uint8_t*> free_pages;     // Released by clear(), reused before allocating
+
+    // Storage of the page holding byte_addr, allocated or unshared on first write
+    uint8_t* writablePage(uint32_t byte_addr) {
+        uint8_t* page = writable_table[byte_addr >> PAGE_SHIFT];
+        if (page == nullptr) {
+            page = makeWritable(byte_addr >> PAGE_SHIFT);
+        }
+        return page;
+    }
+
+    uint8_t* makeWritable(uint32_t page_index);
+    uint8_t* takePage();
+    void releasePage(uint8_t* page);
+
+    // Pages carry a reference count in a small header in front of the data
+    static constexpr size_t PAGE_HEADER = 16;
+    static uint32_t& pageRefs(uint8_t* page) { return *reinterpret_cast<uint32_t*>(page - PAGE_HEADER); }
+    static uint8_t* newPage();
+    static void deletePage(uint8_t* page) { delete[] (page - PAGE_HEADER); }
+
+    // Memory is little-endian; swap on big-endian hosts only
+    static uint32_t toLittleEndian(uint32_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_bswap32(value);
+#else
+        return value;
+#endif
+    }
+
+    // Not copyable: pages are owned
+    SparseMemory(const SparseMemory&);
+    SparseMemory& operator=(const SparseMemory&);
+};
+
+#endif // GOLDEN_MODEL_MEMORY_H
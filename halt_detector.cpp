@@ -0,0 +1,93 @@
+#include "halt_detector.h"
+#include <cstring>
+
+constexpr uint32_t ExitPort::BASE;
+constexpr uint32_t ExitPort::SIZE;
+constexpr uint32_t HaltDetector::EBREAK;
+constexpr size_t HaltDetector::REGISTER_COUNT;
+
+
+ExitPort::ExitPort()
+    : done(false), exit_code(0) {
+}
+
+
+uint32_t ExitPort::read(uint32_t) {
+    return exit_code;
+}
+
+
+void ExitPort::write(uint32_t, uint32_t wdata, uint8_t wstrb) {
+    if ((wstrb & 0xF) == 0) return;
+    if ((wstrb & 0xF) == 0xF) {
+        exit_code = wdata;
+    } else {
+        // Byte store: the lowest strobed lane
+        int lane = 0;
+        while (!(wstrb & (1 << lane))) lane++;
+        exit_code = (wdata >> (8 * lane)) & 0xFF;
+    }
+    done = true;
+}
+
+
+void ExitPort::clear() {
+    done = false;
+    exit_code = 0;
+}
+
+
+void ExitPort::restore(bool exited, uint32_t code) {
+    done = exited;
+    exit_code = code;
+}
+
+
+HaltDetector::HaltDetector(const ExitPort* port, bool am_halt)
+    : port(port), am_halt(am_halt), why(HaltReason::None), exit_code(0), last_a0(0),
+      jalr_seen(false), jalr_pc(0), stored(false) {
+    memset(jalr_registers, 0, sizeof(jalr_registers));
+}
+
+
+bool HaltDetector::observe(uint32_t pc, uint32_t instr, const uint32_t* registers) {
+    last_a0 = registers[10];
+
+    if (port != nullptr && port->exited()) {
+        why = HaltReason::ExitPort;
+        exit_code = port->code();
+        return true;
+    }
+    if (instr == EBREAK) {
+        why = HaltReason::Ebreak;
+        exit_code = registers[10];
+        return true;
+    }
+
+    uint32_t opcode = instr & 0x7F;
+    if (opcode == 0x23) {
+        stored = true;
+    } else if (opcode == 0x67) {
+        if (jalr_seen && pc == jalr_pc && !stored &&
+            memcmp(registers, jalr_registers, sizeof(jalr_registers)) == 0) {
+            why = HaltReason::SelfLoop;
+            exit_code = am_halt ? registers[10] : 0;
+            return true;
+        }
+        jalr_seen = true;
+        jalr_pc = pc;
+        memcpy(jalr_registers, registers, sizeof(jalr_registers));
+        stored = false;
+    }
+    return false;
+}
+
+
+const char* HaltDetector::reasonName(HaltReason reason) {
+    switch (reason) {
+        case HaltReason::SelfLoop: return "self-loop";
+        case HaltReason::ExitPort: return "exit port";
+        case HaltReason::Ebreak:   return "ebreak";
+        default:                   return "none";
+    }
+}
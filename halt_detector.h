@@ -0,0 +1,86 @@
+#ifndef HALT_DETECTOR_H
+#define HALT_DETECTOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include "memory_fabric.h"
+
+// Magic exit address: a store to BASE ends the program with the stored value
+// as its exit code (SW: the word, SB: the byte).
+class ExitPort : public MmioDevice {
+public:
+    static constexpr uint32_t BASE = 0x10001000;
+    static constexpr uint32_t SIZE = 4;
+
+    ExitPort();
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t wdata, uint8_t wstrb) override;
+
+    bool exited() const { return done; }
+    uint32_t code() const { return exit_code; }
+    void clear();
+
+    // Return to a state read with exited() and code() (checkpoints)
+    void restore(bool exited, uint32_t code);
+
+private:
+    bool done;
+    uint32_t exit_code;
+};
+
+
+// Why HaltDetector::observe stopped the program
+enum class HaltReason {
+    None,
+    SelfLoop,   // A JALR was reached again with the same registers and no store in between
+    ExitPort,   // The program stored to ExitPort::BASE
+    Ebreak      // The next instruction is EBREAK; exit code a0
+};
+
+// Detects that a program has finished, from the state before each
+// instruction retires (pc, instruction word, registers), so the golden model
+// and the RTL testbench stop at the same point:
+//   - EBREAK (0x00100073) about to execute, exit code a0 (x10)
+//   - a store to the ExitPort, if one is given
+//   - a spin loop: two consecutive JALRs at the same pc with identical
+//     registers and no store between them. miniRV only branches through
+//     JALR, so the code in between is straight-line and will repeat forever
+//     (the AM `halt` loop, `jalr zero, 0(tp)` back to itself). Exit code 0,
+//     a0 is reported with it; with am_halt set the exit code is a0, where
+//     AM's halt(code) leaves the code before spinning.
+class HaltDetector {
+public:
+    static constexpr uint32_t EBREAK = 0x00100073;
+
+    // port: the exit port of the memory the observed model stores to (may be null)
+    // am_halt: a spin loop exits with a0 (AM halt(code)) instead of 0
+    explicit HaltDetector(const ExitPort* port = nullptr, bool am_halt = false);
+
+    // Look at the next instruction to retire; returns true (with reason()
+    // and exitCode() set) once the program has finished
+    bool observe(uint32_t pc, uint32_t instr, const uint32_t* registers);
+
+    HaltReason reason() const { return why; }
+    uint32_t exitCode() const { return exit_code; }
+    uint32_t a0() const { return last_a0; }
+
+    // "self-loop", "exit port", "ebreak" or "none"
+    static const char* reasonName(HaltReason reason);
+
+private:
+    static constexpr size_t REGISTER_COUNT = 16;
+
+    const ExitPort* port;
+    bool am_halt;
+    HaltReason why;
+    uint32_t exit_code;
+    uint32_t last_a0;
+
+    bool jalr_seen;
+    uint32_t jalr_pc;
+    uint32_t jalr_registers[REGISTER_COUNT];
+    bool stored;                        // A store retired since the last JALR
+};
+
+#endif // HALT_DETECTOR_H
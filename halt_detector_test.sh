@@ -0,0 +1,12 @@
+#!/bin/bash
+# Build the HaltDetector unit test with the CMake build (against the golden_model library) and run it
+
+BUILD_DIR="${BUILD_DIR:-build}"
+
+cmake -S . -B "$BUILD_DIR" > /dev/null && cmake --build "$BUILD_DIR" --target halt_detector_test
+if [ $? -ne 0 ]; then
+    echo "Error: Compilation failed!"
+    exit 1
+fi
+
+./"$BUILD_DIR/halt_detector_test"
@@ -7,24 +7,53 @@ module instruction_fetch(
     // 24-bit byte address = 2^24 bytes = 16,777,216 bytes
     // For 32-bit words: 2^24 / 4 = 2^22 words
     parameter MEMORY_SIZE = 1 << 22;  // 2^22 = 4,194,304 words (24-bit byte addressable)
-    logic [31:0] memory [0:MEMORY_SIZE-1];
 
     parameter INSTRUCTION_MEMORY_FILE = "logisim-bin/sum.memh";
 
+    // logic [31:0] masked_address = 32'b1111_1111_1111_1111_1111_1111_1111_1100;
+    logic [31:0] word_index = address >> 2;
+
+`ifdef PROGRAM_IMAGE_DPI
+    // Program words live in a C++ ProgramMemory (program_memory.h): sparse
+    // pages holding only the program, shared read-only by every instance that
+    // runs it, so an instance is a handle instead of a 16 MiB array and the
+    // program is never parsed by $readmemh. The handle is a longint rather
+    // than a chandle so models built with --savable can save it.
+    import "DPI-C" function longint program_memory_attach();
+    import "DPI-C" pure function int program_memory_read(input longint memory, input int word_index);
+
+    longint program_memory;
+
+    // Attach to the program the testbench selected for this model
+    initial begin
+        program_memory = program_memory_attach();
+    end
+
+    always_comb begin
+        instruction = program_memory_read(program_memory, word_index);
+    end
+`else
+    logic [31:0] memory [0:MEMORY_SIZE-1];
+
+    // +imem=<file.memh> replaces INSTRUCTION_MEMORY_FILE at run time, so
+    // another program needs no rebuild
+    string memory_file;
+
     // Initialize the instruction memory with example program:
     // Program: Load immediates, add them, and loop
     initial begin       
         // Load data from file into the array (limited to MEMORY_SIZE)
-        $readmemh(INSTRUCTION_MEMORY_FILE, memory, 0, MEMORY_SIZE-1);
+        if (!$value$plusargs("imem=%s", memory_file)) begin
+            memory_file = INSTRUCTION_MEMORY_FILE;
+        end
+        $readmemh(memory_file, memory, 0, MEMORY_SIZE-1);
     end
 
-    // logic [31:0] masked_address = 32'b1111_1111_1111_1111_1111_1111_1111_1100;
-    logic [31:0] word_index = address >> 2;
-
     always_comb begin
         // Convert byte address to word index: address[6:2] for 32 words
         // This handles addresses 0, 4, 8, 12, ... up to 124 (31 words)
         instruction = memory[word_index];
     end
+`endif
 
 endmodule
@@ -5,8 +5,8 @@
 #include <sstream>
 #include <vector>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include "Vinstruction_fetch.h"
+#include "verilator_trace.h"
 
 const std::string TEST_PROGRAM_FILE = "logisim-bin/test-pc4.hex";
 int MEMORY_SIZE = 16;
@@ -32,7 +32,7 @@ void read_hex_file(std::string filename, uint32_t* memory) {
 }
 
 
-bool test_read_all_initialized_instructions(Vinstruction_fetch* rom, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_read_all_initialized_instructions(Vinstruction_fetch* rom, TraceFile* tfp, uint64_t& time) {
     uint32_t memory[MEMORY_SIZE];
     read_hex_file(TEST_PROGRAM_FILE, memory);
 
@@ -59,7 +59,7 @@ bool test_read_all_initialized_instructions(Vinstruction_fetch* rom, VerilatedVc
 }
 
 
-bool test_immediate_response(Vinstruction_fetch* rom, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_immediate_response(Vinstruction_fetch* rom, TraceFile* tfp, uint64_t& time) {
     uint32_t memory[MEMORY_SIZE];
     read_hex_file(TEST_PROGRAM_FILE, memory);
 
@@ -87,7 +87,7 @@ bool test_immediate_response(Vinstruction_fetch* rom, VerilatedVcdC* tfp, uint64
 }
 
 
-bool test_full_address_space_coverage(Vinstruction_fetch* rom, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_full_address_space_coverage(Vinstruction_fetch* rom, TraceFile* tfp, uint64_t& time) {
     uint32_t memory[MEMORY_SIZE];
     read_hex_file(TEST_PROGRAM_FILE, memory);
 
@@ -112,11 +112,10 @@ int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Verilated::traceEverOn(true);
     
-    // Create module and VCD trace
+    // Create module and trace
     Vinstruction_fetch* instruction_fetch = new Vinstruction_fetch;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    instruction_fetch->trace(tfp, 99);
-    tfp->open("waveform_rom.vcd");
+    TraceFile* tfp = new TraceFile;
+    tfp->open(instruction_fetch, "waveform_rom.vcd");
     
     uint64_t time = 0;
     
@@ -1,6 +1,6 @@
 #!/bin/bash
-rm -rf obj_dir/
-verilator --cc instruction_fetch.sv --exe instruction_fetch_test.cpp --trace
-make -C obj_dir -f Vinstruction_fetch.mk
-./obj_dir/Vinstruction_fetch
+source ./trace_flags.sh
+verilator --cc instruction_fetch.sv --Mdir obj_dir/instruction_fetch --exe instruction_fetch_test.cpp $TRACE_FLAGS
+make -C obj_dir/instruction_fetch -f Vinstruction_fetch.mk
+./obj_dir/instruction_fetch/Vinstruction_fetch
 # gtkwave waveform_instruction_fetch.vcd
\ No newline at end of file
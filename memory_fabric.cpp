@@ -0,0 +1,113 @@
+#include "memory_fabric.h"
+#include <iostream>
+#include <stdexcept>
+
+// Fabric picked up by the next miniRV initial block
+static MemoryFabric* selected_fabric = nullptr;
+
+
+MemoryFabric::MemoryFabric(SparseMemory& ram)
+    : ram(ram), ram_bytes((uint32_t)ram.size()), dpi_target(this) {
+}
+
+
+void MemoryFabric::mapDevice(uint32_t base, uint32_t size, MmioDevice* device, const std::string& name) {
+    uint64_t end = (uint64_t)base + size;
+    if (device == nullptr || size == 0 || ((base | size) & 3) != 0 || end > (uint64_t(1) << 32)) {
+        std::cerr << "Error: Bad MMIO region " << name << ": base = 0x" << std::hex << base
+                  << ", size = 0x" << size << std::dec << std::endl;
+        throw std::runtime_error("Bad MMIO region");
+    }
+    if (base < ram_bytes) {
+        std::cerr << "Error: MMIO region " << name << " at 0x" << std::hex << base << std::dec
+                  << " overlaps the RAM" << std::endl;
+        throw std::runtime_error("MMIO region overlaps RAM");
+    }
+    for (size_t i = 0; i < regions.size(); i++) {
+        if (base < (uint64_t)regions[i].base + regions[i].size && regions[i].base < end) {
+            std::cerr << "Error: MMIO region " << name << " overlaps " << regions[i].name << std::endl;
+            throw std::runtime_error("MMIO regions overlap");
+        }
+    }
+
+    Region region;
+    region.base = base;
+    region.size = size;
+    region.device = device;
+    region.name = name;
+    regions.push_back(region);
+}
+
+
+// Copy every segment into the RAM, clipped to its size
+void MemoryFabric::loadImage(const ProgramImage& image) {
+    const std::vector<ProgramSegment>& segments = image.segments();
+    for (size_t i = 0; i < segments.size(); i++) {
+        const ProgramSegment& segment = segments[i];
+        if (segment.base >= ram_bytes) continue;
+        size_t length = segment.data.size();
+        if (length > ram_bytes - segment.base) length = ram_bytes - segment.base;
+        ram.writeBlock(segment.base, segment.data.data(), length);
+    }
+}
+
+
+const MemoryFabric::Region* MemoryFabric::findRegion(uint32_t addr) const {
+    for (size_t i = 0; i < regions.size(); i++) {
+        if (addr - regions[i].base < regions[i].size) {
+            return &regions[i];
+        }
+    }
+    return nullptr;
+}
+
+
+bool MemoryFabric::readDevice(uint32_t addr, uint32_t& value) {
+    const Region* region = findRegion(addr);
+    if (region == nullptr) {
+        value = 0;
+        return false;
+    }
+    value = region->device->read((addr - region->base) & ~3u);
+    return true;
+}
+
+
+bool MemoryFabric::writeDevice(uint32_t addr, uint32_t wdata, uint8_t wstrb) {
+    const Region* region = findRegion(addr);
+    if (region == nullptr) return false;
+    region->device->write((addr - region->base) & ~3u, wdata, wstrb);
+    return true;
+}
+
+
+void MemoryFabric::select(MemoryFabric* fabric) {
+    selected_fabric = fabric;
+}
+
+
+MemoryFabric* MemoryFabric::selected() {
+    return selected_fabric;
+}
+
+
+// miniRV.sv initial block: handle of the selected fabric
+long long memory_fabric_attach() {
+    return (long long)(intptr_t)selected_fabric;
+}
+
+
+// miniRV.sv load port: word containing addr
+int memory_fabric_read(long long fabric, int addr) {
+    if (fabric == 0) return 0;
+    uint32_t value;
+    reinterpret_cast<MemoryFabric*>((intptr_t)fabric)->redirected()->readWord((uint32_t)addr, value);
+    return (int)value;
+}
+
+
+// miniRV.sv store port (rising edge)
+void memory_fabric_write(long long fabric, int addr, int wdata, int wstrb) {
+    if (fabric == 0 || (wstrb & 0xF) == 0) return;
+    reinterpret_cast<MemoryFabric*>((intptr_t)fabric)->redirected()->write((uint32_t)addr, (uint32_t)wdata, (uint8_t)(wstrb & 0xF));
+}
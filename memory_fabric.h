@@ -0,0 +1,146 @@
+#ifndef MEMORY_FABRIC_H
+#define MEMORY_FABRIC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "golden_model_memory.h"
+#include "program_image.h"
+
+// Device behind an MMIO region of a MemoryFabric. Offsets are relative to
+// the region base and word aligned (addr[1:0] cleared, like dmem_addr).
+class MmioDevice {
+public:
+    virtual ~MmioDevice() {}
+
+    // Word at offset
+    virtual uint32_t read(uint32_t offset) = 0;
+
+    // Bus write: byte lane i takes wdata[8*i+7:8*i] when wstrb[i] is set
+    virtual void write(uint32_t offset, uint32_t wdata, uint8_t wstrb) = 0;
+};
+
+
+// Data-side address space of miniRV: a flat RAM region at address 0 backed by
+// a SparseMemory, plus MMIO regions registered with mapDevice(). The golden
+// model's loads/stores and the dmem port of miniRV.sv (through the DPI
+// imports below) both go through this class, so the two sides decode
+// addresses, merge strobes and talk to devices with the same code.
+//
+// RAM accesses take one compare before the SparseMemory access; anything
+// above the RAM is looked up in the (short) region list. An address that is
+// neither RAM nor a mapped device reads zero and drops writes; the
+// accessors apply that policy themselves and return false so a caller can
+// report it, but both the golden model and the RTL port just carry on.
+class MemoryFabric {
+public:
+    // RAM region [0, ram.size()); the SparseMemory must outlive the fabric
+    explicit MemoryFabric(SparseMemory& ram);
+
+    // Map `device` at [base, base + size). Regions must be word aligned and
+    // may not overlap the RAM or each other; throws std::runtime_error if
+    // they do. The device must outlive the fabric (it is not owned).
+    void mapDevice(uint32_t base, uint32_t size, MmioDevice* device, const std::string& name);
+
+    // Copy a program's segments into the RAM (anything beyond it is dropped)
+    void loadImage(const ProgramImage& image);
+
+    SparseMemory& memory() { return ram; }
+    const SparseMemory& memory() const { return ram; }
+
+    // True if addr hits the RAM or a device
+    bool mapped(uint32_t addr) const { return addr < ram_bytes || findRegion(addr) != nullptr; }
+
+    // Aligned word containing addr (addr[1:0] ignored); zero when unmapped
+    bool readWord(uint32_t addr, uint32_t& value) {
+        if (addr < ram_bytes) {
+            value = ram.readWord(addr);
+            return true;
+        }
+        return readDevice(addr, value);
+    }
+
+    // Byte at addr; zero when unmapped
+    bool readByte(uint32_t addr, uint8_t& value) {
+        if (addr < ram_bytes) {
+            value = ram.readByte(addr);
+            return true;
+        }
+        uint32_t word;
+        bool hit = readDevice(addr, word);
+        value = (uint8_t)(word >> (8 * (addr & 3)));
+        return hit;
+    }
+
+    // Bus write of the aligned word containing addr (dmem_wdata/dmem_wstrb);
+    // dropped when unmapped
+    bool write(uint32_t addr, uint32_t wdata, uint8_t wstrb) {
+        if (addr < ram_bytes) {
+            if (wstrb == 0xF) ram.writeWord(addr, wdata);
+            else ram.writeStrobe(addr, wdata, wstrb);
+            return true;
+        }
+        return writeDevice(addr, wdata, wstrb);
+    }
+
+    // Full word store (SW); dropped when unmapped
+    bool writeWord(uint32_t addr, uint32_t value) {
+        if (addr < ram_bytes) {
+            ram.writeWord(addr, value);
+            return true;
+        }
+        return writeDevice(addr, value, 0xF);
+    }
+
+    // Byte store (SB): value goes to the addr[1:0] lane; dropped when unmapped
+    bool writeByte(uint32_t addr, uint8_t value) {
+        if (addr < ram_bytes) {
+            ram.writeByte(addr, value);
+            return true;
+        }
+        uint32_t lane = addr & 3;
+        return writeDevice(addr, (uint32_t)value << (8 * lane), (uint8_t)(1u << lane));
+    }
+
+    // Fabric the next miniRV instances attach their dmem port to (nullptr:
+    // none, loads read zero and stores are dropped)
+    static void select(MemoryFabric* fabric);
+    static MemoryFabric* selected();
+
+    // Serve the DPI accesses of models attached to this fabric from `target`
+    // (nullptr: from this fabric again). A Verilated model restored from a
+    // checkpoint keeps the handle it attached to, so this is how a replay
+    // runs it against a separate address space.
+    void redirect(MemoryFabric* target) { dpi_target = target != nullptr ? target : this; }
+    MemoryFabric* redirected() const { return dpi_target; }
+
+private:
+    struct Region {
+        uint32_t base;
+        uint32_t size;
+        MmioDevice* device;
+        std::string name;
+    };
+
+    SparseMemory& ram;
+    uint32_t ram_bytes;
+    std::vector<Region> regions;
+    MemoryFabric* dpi_target;
+
+    const Region* findRegion(uint32_t addr) const;
+    bool readDevice(uint32_t addr, uint32_t& value);
+    bool writeDevice(uint32_t addr, uint32_t wdata, uint8_t wstrb);
+
+    MemoryFabric(const MemoryFabric&);
+    MemoryFabric& operator=(const MemoryFabric&);
+};
+
+// DPI imports of miniRV.sv's dmem port; the handle is the MemoryFabric address
+extern "C" {
+    long long memory_fabric_attach();
+    int memory_fabric_read(long long fabric, int addr);
+    void memory_fabric_write(long long fabric, int addr, int wdata, int wstrb);
+}
+
+#endif // MEMORY_FABRIC_H
@@ -7,7 +7,19 @@ module miniRV (
 
     output logic [31:0] pc,
     output logic [31:0] instruction,
-    output logic [31:0] registers [0:15]
+    output logic [31:0] registers [0:15],
+
+    // Retirement record of the instruction at pc, valid before the rising
+    // edge that commits it (commit-log co-simulation, see RetireRecord in
+    // golden_model_cpu.h). Unused fields are zero.
+    output logic        retire_valid,
+    output logic [31:0] retire_pc,
+    output logic [31:0] retire_instr,
+    output logic [4:0]  retire_rd,          // 0: no register write
+    output logic [31:0] retire_rd_wdata,
+    output logic [31:0] retire_mem_addr,
+    output logic [31:0] retire_mem_wdata,
+    output logic [3:0]  retire_mem_wstrb    // 0: no store
 );
 
     // ========== Memory Interfaces ==========
@@ -56,7 +68,6 @@ module miniRV (
     // Memory read data processing
     logic [31:0] mem_rdata_processed;
     logic [1:0]  byte_offset;
-    logic [31:0] mem_rdata;
     
     // JALR target
     logic [31:0] jalr_target;
@@ -64,7 +75,7 @@ module miniRV (
     program_counter u_program_counter (
         .clk(clk),
         .opcode(opcode),
-        .set_value(32'h4),
+        .set_value(jalr_target),
         .reset(reset),
 
         .pc_out(pc)
@@ -90,9 +101,32 @@ module miniRV (
         .wb_sel(wb_sel)
     );
 
+    // ========== Control Signals ==========
+    // Only the miniRV subset writes registers or memory (same decode as
+    // GoldenModelCPU::decodeInstruction); anything else just advances the PC
+    assign alu_src   = (opcode != 7'b0110011);                          // all but ADD take imm_32bit
+    assign pc_src    = (opcode == 7'b1100111);                          // JALR
+    assign is_lbu    = (opcode == 7'b0000011) && (funct3 == 3'b100);
+    assign is_sb     = (opcode == 7'b0100011) && (funct3 == 3'b000);
+    assign mem_read  = (opcode == 7'b0000011) && (funct3 == 3'b010 || is_lbu);
+    assign mem_write = (opcode == 7'b0100011) && (funct3 == 3'b010 || is_sb);
+
+    always_comb begin
+        case (opcode)
+            7'b0110011: reg_write = (funct3 == 3'b000) && (funct7 == 7'b0000000);  // ADD
+            7'b0010011: reg_write = (funct3 == 3'b000);                            // ADDI
+            7'b0110111: reg_write = 1'b1;                                          // LUI
+            7'b0000011: reg_write = mem_read;                                      // LW, LBU
+            7'b1100111: reg_write = 1'b1;                                          // JALR
+            default:    reg_write = 1'b0;
+        endcase
+    end
+
+    assign _pc_plus4 = pc + 32'h4;
+
     writeback_mux u_writeback_mux (
         .alu_result(alu_result),
-        .mem_rdata(mem_rdata),
+        .mem_rdata(mem_rdata_processed),
         .pc_plus4(_pc_plus4),
         .imm_u(imm_32bit),
         .wb_sel(wb_sel),
@@ -114,193 +148,151 @@ module miniRV (
         .rdata2(rs2_data)
     );
 
+    // Architectural registers for the testbench
+    generate
+        for (genvar i = 0; i < 16; i++) begin : g_registers
+            assign registers[i] = u_register_file.regs[i];
+        end
+    endgenerate
+
+
+    // ========== ALU ==========
+    // LUI reads x0 as rs1, so rs1 + imm_u is imm_u
+    assign alu_a = rs1_data;
+    assign alu_b = alu_src ? imm_32bit : rs2_data;
 
     alu u_alu (
-        .operand_a(rs1_data),
-        .operand_b(rs2_data),
+        .operand_a(alu_a),
+        .operand_b(alu_b),
         .function_3(funct3),
         .function_7(funct7),
 
         .result(alu_result)
     );
 
-    
-    // // Control signals generation
-    // always_comb begin
-    //     case (wb_sel)
-    //         2'b00: begin
-    //             // ALU result
-    //             rs1_data
-    //             rs2_data
-    //             funct3
-    //             funct7
-    //             alu_result
-
-
-
-    //             reg_write = 1'b1;
-    //             alu_src = 1'b0;
-    //         end
-            
-    //         2'b01: begin
-
-    //         end
-            
-    //         2'b10: begin
-
-    //         end
-            
-    //         2'b11: begin
-    //             // JALR
-    //             reg_write = 1'b1;
-    //             alu_src = 1'b1;  // Use imm_i
-    //             pc_src = 1'b1;   // Jump
-    //             wb_sel = 2'b10;  // PC+4
-    //         end
-            
-    //         default: begin
-    //             illegal_instr = 1'b1;
-    //         end
-    //     endcase
-        
-    //     // Override if illegal register
-    //     if (illegal_reg) begin
-    //         illegal_instr = 1'b1;
-    //         reg_write = 1'b0;
-    //     end
-    // end
-    
-    // // ========== Register File ==========
-    // // register_file now accepts 5-bit addresses (handles conversion internally)
-    // register_file u_register_file (
-    //     .clk(clk),
-    //     .reset(reset),
-    //     .we(reg_write && !illegal_instr),
-    //     .raddr1(rs1),
-    //     .raddr2(rs2),
-    //     .waddr(rd),
-    //     .wdata(wb_data),
-    //     .rdata1(rs1_data),
-    //     .rdata2(rs2_data)
-    // );
-    
-    // // ========== ALU ==========
-    // assign alu_a = rs1_data;
-    
-    // // ALU B selection: stores use imm_s, others use imm_i or rs2
-    // always_comb begin
-    //     if (mem_write) begin
-    //         alu_b = imm_s;  // S-type uses imm_s
-    //     end else begin
-    //         alu_b = alu_src ? imm_i : rs2_data;
-    //     end
-    // end
-    
-    // alu u_alu (
-    //     .operand_a(alu_a),
-    //     .operand_b(alu_b),
-    //     .function_3(funct3),
-    //     .function_7(funct7),
-    //     .result(alu_result)
-    // );
-    
-    // // ========== Data Memory ==========
-    // assign dmem_addr = alu_result;
-    // assign dmem_wdata = rs2_data;
-    
-    // // Write strobe generation
-    // always_comb begin
-    //     if (is_sb && mem_write) begin
-    //         // Byte store: one-hot based on address[1:0]
-    //         case (dmem_addr[1:0])
-    //             2'b00: dmem_wstrb = 4'b0001;
-    //             2'b01: dmem_wstrb = 4'b0010;
-    //             2'b10: dmem_wstrb = 4'b0100;
-    //             2'b11: dmem_wstrb = 4'b1000;
-    //             default: dmem_wstrb = 4'b0000;
-    //         endcase
-    //     end else if (mem_write) begin
-    //         // Word store
-    //         dmem_wstrb = 4'b1111;
-    //     end else begin
-    //         dmem_wstrb = 4'b0000;
-    //     end
-    // end
-    
-    // // Simple data memory model (internal)
-    // parameter DMEM_SIZE = 1024;
-    // logic [31:0] dmem [0:DMEM_SIZE-1];
-    
-    // // Memory address calculation
-    // logic [31:0] dmem_word_addr;
-    // logic [31:0] old_word, new_word;
-    // assign dmem_word_addr = dmem_addr >> 2;
-    
-    // // Memory write
-    // always_ff @(posedge clk) begin
-    //     if (mem_write && !illegal_instr) begin
-    //         if (dmem_word_addr < DMEM_SIZE) begin
-    //             old_word = dmem[dmem_word_addr];
-    //             new_word = old_word;
-                
-    //             if (dmem_wstrb[0]) new_word[7:0]   = dmem_wdata[7:0];
-    //             if (dmem_wstrb[1]) new_word[15:8]  = dmem_wdata[15:8];
-    //             if (dmem_wstrb[2]) new_word[23:16] = dmem_wdata[23:16];
-    //             if (dmem_wstrb[3]) new_word[31:24] = dmem_wdata[31:24];
-                
-    //             dmem[dmem_word_addr] <= new_word;
-    //         end
-    //     end
-    // end
-    
-    // // Memory read
-    // always_comb begin
-    //     if (dmem_word_addr < DMEM_SIZE) begin
-    //         dmem_rdata = dmem[dmem_word_addr];
-    //     end else begin
-    //         dmem_rdata = 32'h0;
-    //     end
-    // end
-    
-    // // Memory read data processing
-    // assign byte_offset = dmem_addr[1:0];
-    // always_comb begin
-    //     if (is_lbu && mem_read) begin
-    //         // Byte load: select byte and zero-extend
-    //         case (byte_offset)
-    //             2'b00: mem_rdata_processed = {24'h0, dmem_rdata[7:0]};
-    //             2'b01: mem_rdata_processed = {24'h0, dmem_rdata[15:8]};
-    //             2'b10: mem_rdata_processed = {24'h0, dmem_rdata[23:16]};
-    //             2'b11: mem_rdata_processed = {24'h0, dmem_rdata[31:24]};
-    //             default: mem_rdata_processed = 32'h0;
-    //         endcase
-    //     end else begin
-    //         mem_rdata_processed = dmem_rdata;  // lw or no load
-    //     end
-    // end
-    
-    // // ========== Writeback Mux ==========
-    // writeback_mux u_writeback_mux (
-    //     .alu_result(alu_result),
-    //     .mem_rdata(mem_rdata_processed),
-    //     .pc_plus4(pc_plus4),
-    //     .imm_u(imm_u),
-    //     .wb_sel(wb_sel),
-    //     .wb_data(wb_data)
-    // );
-    
-    // // ========== PC Next Logic ==========
-    // // For jalr: PC = (rs1 + imm_i) & ~1
-    // assign jalr_target = (rs1_data + imm_i) & 32'hFFFFFFFE;
-    
-    // always_comb begin
-    //     if (illegal_instr) begin
-    //         pc_next = pc_plus4;  // NOP, just increment PC
-    //     end else if (pc_src) begin
-    //         pc_next = jalr_target;  // jalr
-    //     end else begin
-    //         pc_next = pc_plus4;  // Sequential
-    //     end
-    // end
+    // For jalr: PC = (rs1 + imm_i) & ~1
+    assign jalr_target = (rs1_data + imm_32bit) & 32'hFFFFFFFE;
+
+
+    // ========== Data Memory ==========
+    // Loads and stores address rs1 + imm directly (the ALU only decodes
+    // add/sub/and/or funct3 values, not the load/store ones)
+    assign dmem_addr   = rs1_data + imm_32bit;
+    assign byte_offset = dmem_addr[1:0];
+
+    // Store data on the bus lanes: SB moves rs2[7:0] to its byte lane
+    assign dmem_wdata = is_sb ? ({24'h0, rs2_data[7:0]} << {byte_offset, 3'b000}) : rs2_data;
+
+    // Write strobe generation
+    always_comb begin
+        if (reset || !mem_write) begin
+            dmem_wstrb = 4'b0000;
+        end else if (is_sb) begin
+            // Byte store: one-hot based on address[1:0]
+            dmem_wstrb = 4'b0001 << byte_offset;
+        end else begin
+            // Word store
+            dmem_wstrb = 4'b1111;
+        end
+    end
+
+`ifdef PROGRAM_IMAGE_DPI
+    // Data memory is a C++ MemoryFabric (memory_fabric.h): flat RAM plus the
+    // MMIO devices the testbench mapped, the same code the golden model's
+    // loads and stores go through. Stores commit on the rising edge; loads
+    // read combinationally and only while mem_read is set, so a load always
+    // sees the stores committed before it (the call re-evaluates when
+    // mem_read rises). The handle is a longint for --savable, like
+    // instruction_fetch.sv's.
+    import "DPI-C" function longint memory_fabric_attach();
+    import "DPI-C" function int memory_fabric_read(input longint fabric, input int addr);
+    import "DPI-C" function void memory_fabric_write(input longint fabric, input int addr, input int wdata, input int wstrb);
+
+    longint memory_fabric;
+
+    // Attach to the fabric the testbench selected for this model
+    initial begin
+        memory_fabric = memory_fabric_attach();
+    end
+
+    always_comb begin
+        dmem_rdata = mem_read ? memory_fabric_read(memory_fabric, dmem_addr) : 32'h0;
+    end
+
+    always_ff @(posedge clk) begin
+        if (dmem_wstrb != 4'b0000) begin
+            memory_fabric_write(memory_fabric, dmem_addr, dmem_wdata, {28'h0, dmem_wstrb});
+        end
+    end
+`else
+    // Data RAM only (no MMIO), loaded with the program like instruction_fetch.sv
+    parameter DMEM_SIZE = 1 << 22;  // words, 24-bit byte address space
+    parameter DATA_MEMORY_FILE = "logisim-bin/sum.memh";
+
+    logic [31:0] dmem [0:DMEM_SIZE-1];
+    logic [31:0] dmem_word_addr;
+    string dmem_file;
+
+    assign dmem_word_addr = dmem_addr >> 2;
+
+    initial begin
+        if (!$value$plusargs("imem=%s", dmem_file)) begin
+            dmem_file = DATA_MEMORY_FILE;
+        end
+        $readmemh(dmem_file, dmem, 0, DMEM_SIZE-1);
+    end
+
+    // Memory write: unmapped addresses are dropped
+    always_ff @(posedge clk) begin
+        if (dmem_wstrb != 4'b0000 && dmem_word_addr < DMEM_SIZE) begin
+            if (dmem_wstrb[0]) dmem[dmem_word_addr][7:0]   <= dmem_wdata[7:0];
+            if (dmem_wstrb[1]) dmem[dmem_word_addr][15:8]  <= dmem_wdata[15:8];
+            if (dmem_wstrb[2]) dmem[dmem_word_addr][23:16] <= dmem_wdata[23:16];
+            if (dmem_wstrb[3]) dmem[dmem_word_addr][31:24] <= dmem_wdata[31:24];
+        end
+    end
+
+    // Memory read: unmapped addresses read zero
+    always_comb begin
+        if (mem_read && dmem_word_addr < DMEM_SIZE) begin
+            dmem_rdata = dmem[dmem_word_addr];
+        end else begin
+            dmem_rdata = 32'h0;
+        end
+    end
+`endif
+
+    // Memory read data processing
+    always_comb begin
+        if (is_lbu) begin
+            // Byte load: select byte and zero-extend
+            case (byte_offset)
+                2'b00: mem_rdata_processed = {24'h0, dmem_rdata[7:0]};
+                2'b01: mem_rdata_processed = {24'h0, dmem_rdata[15:8]};
+                2'b10: mem_rdata_processed = {24'h0, dmem_rdata[23:16]};
+                2'b11: mem_rdata_processed = {24'h0, dmem_rdata[31:24]};
+                default: mem_rdata_processed = 32'h0;
+            endcase
+        end else begin
+            mem_rdata_processed = dmem_rdata;  // lw or no load
+        end
+    end
+
+
+    // ========== Retirement Record ==========
+    // The register write is taken from the register file's own write port,
+    // so the record shows what it commits: x0 is dropped and only rd[3:0]
+    // addresses x0-x15
+    logic rd_written;
+    assign rd_written = u_register_file.we && (u_register_file.waddr_4bit != 4'h0);
+
+    assign retire_valid     = !reset;
+    assign retire_pc        = pc;
+    assign retire_instr     = instruction;
+    assign retire_rd        = rd_written ? {1'b0, u_register_file.waddr_4bit} : 5'd0;
+    assign retire_rd_wdata  = rd_written ? u_register_file.wdata : 32'h0;
+    assign retire_mem_addr  = (dmem_wstrb != 4'b0000) ? dmem_addr : 32'h0;
+    assign retire_mem_wdata = (dmem_wstrb != 4'b0000) ? dmem_wdata : 32'h0;
+    assign retire_mem_wstrb = dmem_wstrb;
 
 endmodule
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <verilated.h>
+#include "VminiRV.h"
+#include "program_image.h"
+#include "program_memory.h"
+#include "memory_fabric.h"
+#include "vga_device.h"
+#include "uart_device.h"
+
+// miniRV RTL throughput benchmark
+// Runs the Verilated miniRV alone (no golden model, no tracing) on each
+// program and reports simulated clock cycles per second. miniRV_bench.sh
+// builds it once with the default Verilator options and once with the
+// performance profile (threads, -O3, PGO) to compare the two.
+// +instances=<n> clocks n models side by side; they share one ProgramMemory,
+// so the extra instances cost their model state and nothing per program word;
+// each has its own data RAM, VGA framebuffer and UART (a MemoryFabric); the
+// RAM and framebuffer only hold pages it wrote besides the program's.
+
+const long long BENCH_CHUNK = 1000000;
+
+
+// Reset, then clock every model for `cycles` cycles; returns model cycles
+// per second summed over the models
+double run_benchmark(const std::vector<VminiRV*>& cpus, long long cycles) {
+    for (size_t m = 0; m < cpus.size(); m++) {
+        cpus[m]->reset = 1;
+        cpus[m]->clk = 0;
+        cpus[m]->eval();
+        cpus[m]->clk = 1;
+        cpus[m]->eval();
+        cpus[m]->reset = 0;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long long done = 0; done < cycles; done += BENCH_CHUNK) {
+        long long chunk = cycles - done < BENCH_CHUNK ? cycles - done : BENCH_CHUNK;
+        for (long long i = 0; i < chunk; i++) {
+            for (size_t m = 0; m < cpus.size(); m++) {
+                cpus[m]->clk = 0;
+                cpus[m]->eval();
+                cpus[m]->clk = 1;
+                cpus[m]->eval();
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return cycles * cpus.size() / elapsed.count();
+}
+
+
+int main(int argc, char** argv) {
+    long long cycles = 10000000;
+    std::vector<std::string> hex_files;
+
+    // Usage: VminiRV_bench [cycles] [hex files...] [+instances=<n>] [+verilator+... options]
+    Verilated::commandArgs(argc, argv);
+    size_t instances = 1;
+    const char* instances_arg = Verilated::commandArgsPlusMatch("instances=");
+    if (instances_arg != nullptr && instances_arg[0] != '\0') {
+        instances = std::stoul(instances_arg + strlen("+instances="));
+    }
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '+') args.push_back(argv[i]);
+    }
+    if (!args.empty()) {
+        cycles = std::stoll(args[0]);
+    }
+    for (size_t i = 1; i < args.size(); i++) {
+        hex_files.push_back(args[i]);
+    }
+    if (hex_files.empty()) {
+        hex_files.push_back("logisim-bin/test-vga.hex");
+    }
+
+    std::cout << "miniRV RTL benchmark (" << cycles << " cycles per run, "
+              << instances << " instance" << (instances == 1 ? "" : "s") << ")\n";
+    std::cout << "==================================================\n";
+
+    for (size_t i = 0; i < hex_files.size(); i++) {
+        ProgramImage program;
+        if (!program.loadCached(hex_files[i])) {
+            return 1;
+        }
+        ProgramMemory memory(program);
+        ProgramMemory::select(&memory);
+
+        // Fresh models per program: instruction_fetch.sv attaches to memory
+        // and the dmem port to its data fabric on the first eval()
+        std::vector<VminiRV*> cpus;
+        std::vector<SparseMemory*> data_rams;
+        std::vector<MemoryFabric*> data_buses;
+        std::vector<VgaFramebuffer*> vgas;
+        std::vector<UartDevice*> uarts;
+        for (size_t m = 0; m < instances; m++) {
+            data_rams.push_back(new SparseMemory(ProgramMemory::DEFAULT_BYTES));
+            data_buses.push_back(new MemoryFabric(*data_rams[m]));
+            data_buses[m]->loadImage(program);
+            vgas.push_back(new VgaFramebuffer);
+            data_buses[m]->mapDevice(VgaFramebuffer::BASE, VgaFramebuffer::BYTES, vgas[m], "vga");
+            uarts.push_back(new UartDevice);    // Output discarded
+            data_buses[m]->mapDevice(UartDevice::BASE, UartDevice::SIZE, uarts[m], "uart");
+            MemoryFabric::select(data_buses[m]);
+            cpus.push_back(new VminiRV);
+            cpus[m]->eval();
+        }
+        double rate = run_benchmark(cpus, cycles);
+        for (size_t m = 0; m < cpus.size(); m++) {
+            cpus[m]->final();
+            delete cpus[m];
+            delete data_buses[m];
+            delete vgas[m];
+            delete uarts[m];
+            delete data_rams[m];
+        }
+        ProgramMemory::select(nullptr);
+        MemoryFabric::select(nullptr);
+
+        std::cout << std::left << std::setw(28) << hex_files[i] << std::right << std::fixed << std::setprecision(2)
+                  << " " << std::setw(8) << rate / 1e6 << " M cycles/s  ("
+                  << memory.residentPages() << " program pages)\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#!/bin/bash
+# Build the miniRV RTL benchmark with the default Verilator options and with
+# the performance profile, then compare simulated cycles/second.
+#
+# Performance profile:
+#   --threads $THREADS       multithreaded model evaluation
+#   -O3 --x-assign fast --x-initial fast
+#   --output-split           smaller generated files, compiled in parallel
+#   -O3 -march=native        for the generated C++ and the testbench
+#   PGO=1 (default)          two-pass profile-guided build: a training run of
+#                            a --prof-pgo / -fprofile-generate build writes
+#                            profile.vlt (Verilator thread partitioning) and
+#                            *.gcda (GCC), and the final build uses both
+#
+# Usage: ./miniRV_bench.sh [cycles] [hex files...]   (default: test-vga.hex)
+# Build directories are kept between runs so make only rebuilds what changed.
+
+CYCLES="${1:-10000000}"
+shift
+HEX_FILES="$@"
+THREADS="${THREADS:-$(nproc)}"
+PGO="${PGO:-1}"
+TRAIN_CYCLES="${TRAIN_CYCLES:-2000000}"
+BASE_DIR="obj_dir/bench_base"
+PERF_DIR="obj_dir/bench"
+JOBS="$(nproc)"
+
+SOURCES="miniRV.sv alu.sv control_unit.sv immediate_generator.sv instruction_fetch.sv
+  program_counter.sv register_file.sv writeback_mux.sv"
+TESTBENCH="miniRV_bench.cpp program_image.cpp program_memory.cpp memory_fabric.cpp vga_device.cpp uart_device.cpp golden_model_memory.cpp"
+COMMON_FLAGS="--cc --exe --top-module miniRV +define+PROGRAM_IMAGE_DPI -o VminiRV_bench"
+PERF_FLAGS="--threads $THREADS -O3 --x-assign fast --x-initial fast
+  --output-split 20000 --output-split-cfuncs 20000"
+PERF_CFLAGS="-O3 -march=native"
+
+# verilate <dir> <extra verilator flags...>, then make
+verilate() {
+    local dir="$1"
+    shift
+    verilator $COMMON_FLAGS --Mdir "$dir" $SOURCES $TESTBENCH "$@"
+    if [ $? -ne 0 ]; then
+        echo "Error: Verilation failed!"
+        exit 1
+    fi
+}
+
+build() {
+    local dir="$1"
+    shift
+    make -j"$JOBS" -C "$dir" -f VminiRV.mk "$@" > /dev/null
+    if [ $? -ne 0 ]; then
+        echo "Error: Compilation failed!"
+        exit 1
+    fi
+}
+
+echo "Compiling miniRV_bench (default options)..."
+verilate "$BASE_DIR"
+build "$BASE_DIR"
+
+if [ "$PGO" = "1" ]; then
+    echo "Compiling miniRV_bench (performance profile, PGO training build)..."
+    rm -f "$PERF_DIR"/*.gcda
+    verilate "$PERF_DIR" $PERF_FLAGS --prof-pgo \
+        -CFLAGS "$PERF_CFLAGS -fprofile-generate" -LDFLAGS "-fprofile-generate"
+    build "$PERF_DIR" OPT_FAST="$PERF_CFLAGS -fprofile-generate"
+
+    echo "Training on ${HEX_FILES:-logisim-bin/test-vga.hex}..."
+    ./"$PERF_DIR"/VminiRV_bench "$TRAIN_CYCLES" $HEX_FILES \
+        +verilator+prof+vlt+file+"$PERF_DIR"/profile.vlt > /dev/null
+
+    echo "Compiling miniRV_bench (performance profile, PGO final build)..."
+    PGO_CFLAGS="$PERF_CFLAGS -fprofile-use -fprofile-partial-training -Wno-missing-profile -Wno-error=coverage-mismatch"
+    verilate "$PERF_DIR" $PERF_FLAGS "$PERF_DIR"/profile.vlt -CFLAGS "$PGO_CFLAGS"
+    build "$PERF_DIR" OPT_FAST="$PGO_CFLAGS"
+else
+    echo "Compiling miniRV_bench (performance profile)..."
+    verilate "$PERF_DIR" $PERF_FLAGS -CFLAGS "$PERF_CFLAGS"
+    build "$PERF_DIR" OPT_FAST="$PERF_CFLAGS"
+fi
+
+echo ""
+echo "Default options:"
+./"$BASE_DIR"/VminiRV_bench "$CYCLES" $HEX_FILES
+echo ""
+echo "Performance profile (--threads $THREADS, PGO=$PGO):"
+./"$PERF_DIR"/VminiRV_bench "$CYCLES" $HEX_FILES
@@ -4,13 +4,95 @@
 #include <string>
 #include <bitset>
 #include <cstring>
+#include <cstdio>
+#include <csignal>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
+#include <verilated_save.h>
 #include "VminiRV.h"
+#include "verilator_trace.h"
 #include "golden_model_cpu.h"
+#include "trace_ring.h"
+#include "spsc_ring.h"
+#include "program_memory.h"
+#include "memory_fabric.h"
+#include "vga_device.h"
+#include "uart_device.h"
+#include "halt_detector.h"
 
 size_t REGISTER_LIMIT = 16;
 int TEST_CYCLE_LIMIT = 6;
+// Print the compared state every cycle (+verbose); otherwise only mismatches are printed
+bool VERBOSE_COMPARE = false;
+// Commit-log co-simulation: every cycle the retire_* ports of miniRV.sv are
+// sampled into a batch of RETIRE_BATCH records, the golden model fills the
+// matching batch with GoldenModelCPU::retire(), and the two streams are
+// compared with one memcmp per batch. A mismatch names the first wrong write.
+// +full_compare also compares pc, instruction and the register file after
+// every cycle (batches of one).
+size_t RETIRE_BATCH = 1024;
+bool FULL_COMPARE = false;
+// The golden model runs ahead on its own thread, passing its records through
+// a lock-free ring of GOLDEN_RING_RECORDS; +golden_sync (or +full_compare,
+// which needs both models in step) runs it on the testbench thread instead.
+bool GOLDEN_THREAD = true;
+size_t GOLDEN_RING_RECORDS = 65536;
+// Paired checkpoints during the lockstep run: one every CHECKPOINT_INTERVAL
+// cycles, the last CHECKPOINT_KEEP kept. The Verilated model is saved to
+// CHECKPOINT_PREFIX<cycle>.vlt (built with --savable), the golden model to an
+// in-memory CheckpointLog. On a mismatch the nearest pair is replayed up to
+// the failing cycle with full tracing into REPLAY_VCD_FILE, so only the last
+// interval has to be traced; the golden half is also written to
+// CHECKPOINT_FILE (golden_model_main <hex> <snapshot>).
+uint64_t CHECKPOINT_INTERVAL = 1000000;
+size_t CHECKPOINT_KEEP = 8;
+const char* CHECKPOINT_FILE = "golden_checkpoint.snap";
+const char* CHECKPOINT_PREFIX = "miniRV_checkpoint_";
+const char* REPLAY_VCD_FILE = "waveform_miniRV_replay.vcd";
+
+// Divergence-only waveforms: the top-level signals of the last
+// TRACE_RING_CYCLES cycles are kept in memory and written to RING_VCD_FILE
+// only on a mismatch, at the end of the run with +trace_dump, or on SIGUSR1
+// (kill -USR1 <pid>) while running. +trace_full additionally writes the full-run
+// waveform_miniRV.vcd as before.
+size_t TRACE_RING_CYCLES = 4096;
+const char* RING_VCD_FILE = "waveform_miniRV_ring.vcd";
+bool FULL_TRACE = false;
+bool TRACE_DUMP_AT_END = false;
+
+// The model's VGA framebuffer (VgaFramebuffer::BASE) is dumped every
+// VGA_DUMP_INTERVAL cycles and at the end of the run, only if a scanline
+// changed: VGA_DUMP_PREFIX<program>_<n>.ppm frames, or with +vga=raw the
+// changed scanlines appended to VGA_DUMP_PREFIX<program>.raw (+vga=none: off)
+FrameFormat VGA_DUMP_FORMAT = FrameFormat::Ppm;
+uint64_t VGA_DUMP_INTERVAL = 1000000;
+const char* VGA_DUMP_PREFIX = "miniRV_vga_";
+
+// Bytes the model writes to its UART (UartDevice::BASE) go to stdout, or to
+// the file named by +uart=<file>, flushed once per retire batch
+FILE* UART_OUTPUT = stdout;
+
+// A spin-loop halt exits with code 0; +am_halt takes the code from a0 instead,
+// for programs that follow the AM halt(code) convention
+bool AM_HALT = false;
+
+static volatile sig_atomic_t trace_dump_requested = 0;
+
+void request_trace_dump(int) {
+    trace_dump_requested = 1;
+}
+
+// Saved Verilated model state, paired with the golden snapshot of the same cycle
+struct RtlCheckpoint {
+    uint64_t cycle;
+    std::string file;
+    MemorySnapshot data;    // The model's data RAM and devices, which live outside the model
+    DeviceSnapshot devices;
+};
 
 
 // Helper function to print instruction name
@@ -44,24 +126,48 @@ void print_registers(VminiRV* cpu, const char* label) {
 }
 
 
-// Test helper: Run CPU for N cycles
-void run_cycles(VminiRV* cpu, VerilatedVcdC* tfp, uint64_t& time, int cycles) {
+// Copy the retire_* ports into record; sampled after the falling edge, before
+// the rising edge commits the instruction
+void sample_retire(VminiRV* cpu, RetireRecord& record) {
+    record = RetireRecord();
+    if (!cpu->retire_valid) return;
+    record.pc = cpu->retire_pc;
+    record.instr = cpu->retire_instr;
+    record.rd = cpu->retire_rd;
+    record.rd_wdata = cpu->retire_rd_wdata;
+    record.mem_addr = cpu->retire_mem_addr;
+    record.mem_wdata = cpu->retire_mem_wdata;
+    record.mem_wstrb = cpu->retire_mem_wstrb;
+}
+
+
+// Test helper: Run CPU for N cycles, dumping both edges to tfp and ring when set
+// and writing one retirement record per cycle to `retired` when set
+void run_cycles(VminiRV* cpu, TraceFile* tfp, uint64_t& time, int cycles, TraceRing* ring = nullptr,
+                RetireRecord* retired = nullptr) {
     for (int i = 0; i < cycles; i++) {
         // std::cout << "miniRV cpu pc in run_cycles: " << cpu->pc << "\n";
         cpu->clk = 0;
         cpu->eval();
-        tfp->dump(time++);
+        if (tfp) tfp->dump(time);
+        if (ring) ring->sample(time);
+        if (retired) sample_retire(cpu, retired[i]);
+        time++;
         
         cpu->clk = 1;
         cpu->eval();
-        tfp->dump(time++);
+        if (tfp) tfp->dump(time);
+        if (ring) ring->sample(time);
+        time++;
 
         // std::cout << "miniRV cpu pc after clock cycle in run_cycles: " << cpu->pc << "\n";
     }
 }
 
 
-bool compare_cpus(VminiRV* miniRV_cpu, GoldenModelCPU* golden_cpu, int cycle) {
+// Full comparison with per-field output; throws on the first difference.
+// Only used on a mismatch, or every cycle with +verbose.
+bool compare_cpus_verbose(VminiRV* miniRV_cpu, GoldenModelCPU* golden_cpu, int cycle) {
     
     std::cout << "cycle in compare_cpus: \t" << cycle << "\n";
     // std::cout << "\t golden model pc in compare_cpus: \t 0x" << std::hex << std::setfill('0') << std::setw(8) << golden_cpu->pc << std::dec << "\n";
@@ -94,7 +200,7 @@ bool compare_cpus(VminiRV* miniRV_cpu, GoldenModelCPU* golden_cpu, int cycle) {
     // Compare all registers
     uint32_t miniRV_registers[REGISTER_LIMIT];
     uint32_t golden_registers[REGISTER_LIMIT];
-    memcpy(miniRV_registers, miniRV_cpu->registers, sizeof(uint32_t) * REGISTER_LIMIT);
+    memcpy(miniRV_registers, &miniRV_cpu->registers[0], sizeof(uint32_t) * REGISTER_LIMIT);
     memcpy(golden_registers, golden_cpu->registers, sizeof(uint32_t) * REGISTER_LIMIT);
 
     for (int i = 0; i < REGISTER_LIMIT; i++) {
@@ -111,36 +217,339 @@ bool compare_cpus(VminiRV* miniRV_cpu, GoldenModelCPU* golden_cpu, int cycle) {
 }
 
 
-int main(int argc, char** argv) {
+// Lockstep check run every cycle. PC, instruction and the whole register file
+// are compared in place (the 64-byte register memcmp is a few vector
+// compares), with no copies and no iostream formatting; the verbose path
+// only runs once something differs.
+bool compare_cpus(VminiRV* miniRV_cpu, GoldenModelCPU* golden_cpu, int cycle) {
+    bool match = miniRV_cpu->pc == golden_cpu->pc
+              && miniRV_cpu->instruction == golden_cpu->getInstruction()
+              && memcmp(&miniRV_cpu->registers[0], golden_cpu->registers, sizeof(golden_cpu->registers)) == 0;
+    if (match && !VERBOSE_COMPARE) {
+        return true;
+    }
+    return compare_cpus_verbose(miniRV_cpu, golden_cpu, cycle);
+}
+
+
+// One retirement record as "pc 0x... instr 0x... NAME x5 <= 0x... mem[0x...] <= 0x... (strobe 0x.)"
+void print_retire_record(const char* label, const RetireRecord& record) {
+    std::cout << "\t " << label << " pc 0x" << std::hex << std::setfill('0') << std::setw(8) << record.pc
+              << " instr 0x" << std::setw(8) << record.instr << " " << instruction_name(record.instr);
+    if (record.rd != 0) {
+        std::cout << " x" << std::dec << (int)record.rd << " <= 0x" << std::hex << std::setw(8) << record.rd_wdata;
+    }
+    if (record.mem_wstrb != 0) {
+        std::cout << " mem[0x" << std::setw(8) << record.mem_addr << "] <= 0x" << std::setw(8) << record.mem_wdata
+                  << " (strobe 0x" << (int)record.mem_wstrb << ")";
+    }
+    std::cout << std::dec << "\n";
+}
+
+
+// Commit-log check of one batch; records[n] retired in cycle first_cycle + n.
+// Matching streams cost a single memcmp. Otherwise the first differing record
+// is reported, naming the first field that differs, and its index returned;
+// returns count when the whole batch matches.
+size_t compare_retired(const RetireRecord* designed, const RetireRecord* golden, size_t count, uint64_t first_cycle) {
+    if (memcmp(designed, golden, count * sizeof(RetireRecord)) == 0) {
+        if (VERBOSE_COMPARE) {
+            for (size_t n = 0; n < count; n++) {
+                std::cout << "cycle " << first_cycle + n << ":\n";
+                print_retire_record("retired:", designed[n]);
+            }
+        }
+        return count;
+    }
+
+    size_t n = 0;
+    while (memcmp(&designed[n], &golden[n], sizeof(RetireRecord)) == 0) n++;
+    const RetireRecord& d = designed[n];
+    const RetireRecord& g = golden[n];
+
+    const char* field;
+    uint32_t designed_value, golden_value;
+    if (d.pc != g.pc) {
+        field = "PC"; designed_value = d.pc; golden_value = g.pc;
+    } else if (d.instr != g.instr) {
+        field = "Instruction"; designed_value = d.instr; golden_value = g.instr;
+    } else if (d.rd != g.rd) {
+        field = "Write register"; designed_value = d.rd; golden_value = g.rd;
+    } else if (d.rd_wdata != g.rd_wdata) {
+        field = "Write data"; designed_value = d.rd_wdata; golden_value = g.rd_wdata;
+    } else if (d.mem_wstrb != g.mem_wstrb) {
+        field = "Store strobe"; designed_value = d.mem_wstrb; golden_value = g.mem_wstrb;
+    } else if (d.mem_addr != g.mem_addr) {
+        field = "Store address"; designed_value = d.mem_addr; golden_value = g.mem_addr;
+    } else {
+        field = "Store data"; designed_value = d.mem_wdata; golden_value = g.mem_wdata;
+    }
+    std::cout << "  err Cycle " << std::setw(3) << first_cycle + n << ": " << field << " mismatch - Designed CPU: 0x"
+              << std::hex << std::setfill('0') << std::setw(8) << designed_value << std::dec
+              << ", Golden CPU: 0x" << std::hex << std::setfill('0') << std::setw(8) << golden_value << std::dec << "\n";
+    print_retire_record("designed:", d);
+    print_retire_record("golden:  ", g);
+    return n;
+}
+
+
+// Golden-model half of the commit-log check. It retires instructions of
+// `golden` and checkpoints it into `checkpoints` every CHECKPOINT_INTERVAL
+// cycles. Threaded, a worker runs up to GOLDEN_RING_RECORDS instructions ahead
+// of the RTL and read() only waits when the ring is empty; otherwise read()
+// retires the instructions itself. golden and checkpoints belong to the
+// worker until stop().
+class GoldenRetireStream {
+public:
+    GoldenRetireStream(GoldenModelCPU& golden, CheckpointLog& checkpoints, bool threaded)
+        : golden(golden), checkpoints(checkpoints), threaded(threaded), ring(GOLDEN_RING_RECORDS),
+          retired(0), limit(0), stop_requested(false), finished(false) {}
+
+    ~GoldenRetireStream() { stop(); }
+
+    // Produce records for cycles 1..cycles, checkpointing cycle 0 first
+    void start(uint64_t cycles) {
+        limit = cycles;
+        checkpoints.checkpoint(golden, 0);
+        if (threaded) worker = std::thread(&GoldenRetireStream::produce, this);
+    }
+
+    // Copy the next count records to records. Returns count, or fewer if the
+    // golden model stopped on an exception (see error()).
+    size_t read(RetireRecord* records, size_t count) {
+        if (!threaded) return retire(records, count);
+
+        size_t received = 0;
+        while (received < count) {
+            size_t n = ring.pop(records + received, count - received);
+            received += n;
+            if (n == 0) {
+                if (finished.load(std::memory_order_acquire) && ring.size() == 0) break;
+                std::this_thread::yield();
+            }
+        }
+        return received;
+    }
+
+    // Why the golden model stopped early, empty if it did not
+    const std::string& error() const { return failure; }
+
+    // Stop and join the worker; golden and checkpoints are safe to use after
+    void stop() {
+        if (worker.joinable()) {
+            stop_requested.store(true, std::memory_order_release);
+            worker.join();
+        }
+    }
+
+private:
+    GoldenModelCPU& golden;
+    CheckpointLog& checkpoints;
+    bool threaded;
+    SpscRing<RetireRecord> ring;
+    uint64_t retired;                   // Golden cycles retired so far
+    uint64_t limit;
+    std::string failure;
+    std::thread worker;
+    std::atomic<bool> stop_requested;
+    std::atomic<bool> finished;
+
+    // Retire up to count instructions, one record each, checkpointing on the
+    // interval; stops at the first exception and returns the records filled
+    size_t retire(RetireRecord* records, size_t count) {
+        size_t n = 0;
+        try {
+            for (; n < count; n++) {
+                golden.retire(&records[n], 1);
+                checkpoints.maybeCheckpoint(golden, ++retired);
+            }
+        } catch (const std::runtime_error& e) {
+            failure = e.what();
+        }
+        return n;
+    }
+
+    // Worker thread: retire in chunks and push them to the ring
+    void produce() {
+        std::vector<RetireRecord> chunk(RETIRE_BATCH);
+        while (retired < limit && !stop_requested.load(std::memory_order_acquire)) {
+            size_t count = (size_t)std::min<uint64_t>(chunk.size(), limit - retired);
+            size_t filled = retire(&chunk[0], count);
+
+            size_t pushed = 0;
+            while (pushed < filled && !stop_requested.load(std::memory_order_acquire)) {
+                size_t n = ring.push(&chunk[pushed], filled - pushed);
+                pushed += n;
+                if (n == 0) std::this_thread::yield();
+            }
+            if (filled < count) break;
+        }
+        finished.store(true, std::memory_order_release);
+    }
+
+    GoldenRetireStream(const GoldenRetireStream&);
+    GoldenRetireStream& operator=(const GoldenRetireStream&);
+};
+
+
+// Map the devices of a model's data address space, at the addresses the
+// golden model uses
+void map_devices(MemoryFabric& data_bus, VgaFramebuffer& vga, UartDevice& uart, ExitPort& exit_port) {
+    data_bus.mapDevice(VgaFramebuffer::BASE, VgaFramebuffer::BYTES, &vga, "vga");
+    data_bus.mapDevice(UartDevice::BASE, UartDevice::SIZE, &uart, "uart");
+    data_bus.mapDevice(ExitPort::BASE, ExitPort::SIZE, &exit_port, "exit");
+}
+
+
+// Save the Verilated model, its data RAM and devices and the testbench time at
+// `cycle` into rtl_log, paired with the golden checkpoint of the same cycle. The
+// oldest beyond CHECKPOINT_KEEP is dropped together with its file.
+void save_checkpoint(VminiRV* cpu, MemoryFabric& data_bus, VgaFramebuffer& vga, const ExitPort& exit_port,
+                     uint64_t time, uint64_t cycle, std::deque<RtlCheckpoint>& rtl_log) {
+    RtlCheckpoint checkpoint;
+    checkpoint.cycle = cycle;
+    checkpoint.file = CHECKPOINT_PREFIX + std::to_string(cycle) + ".vlt";
+    checkpoint.data = data_bus.memory().snapshot();
+    checkpoint.devices.capture(vga, exit_port);
+
+    VerilatedSave os;
+    os.open(checkpoint.file.c_str());
+    os << time;
+    os << *cpu;
+    os.close();
+
+    rtl_log.push_back(checkpoint);
+    while (rtl_log.size() > CHECKPOINT_KEEP) {
+        std::remove(rtl_log.front().file.c_str());
+        rtl_log.pop_front();
+    }
+}
+
+
+// Re-run cycles (checkpoint.cycle, failed_cycle] from a paired checkpoint
+// into fresh models with full VCD tracing, comparing every cycle again
+void replay_interval(const RtlCheckpoint& checkpoint, MemoryFabric& data_bus, const CpuSnapshot& golden_snapshot, uint64_t failed_cycle) {
+    std::cout << "\nReplaying cycles " << checkpoint.cycle << ".." << failed_cycle
+              << " from " << checkpoint.file << " into " << TraceFile::traceFilename(REPLAY_VCD_FILE) << "\n";
+
+    // A separate address space restored to the checkpoint, so replayed stores
+    // do not reach the run's devices again (no repeated UART output, VGA
+    // scanlines or exit). The restored model keeps its handle to data_bus,
+    // which forwards to it for the length of the replay.
+    SparseMemory replay_ram(data_bus.memory().size());
+    replay_ram.restore(checkpoint.data);
+    MemoryFabric replay_bus(replay_ram);
+    VgaFramebuffer replay_vga;
+    UartDevice replay_uart;     // Output discarded
+    ExitPort replay_exit_port;
+    map_devices(replay_bus, replay_vga, replay_uart, replay_exit_port);
+    checkpoint.devices.apply(replay_vga, replay_exit_port);
+    data_bus.redirect(&replay_bus);
+
+    uint64_t time = 0;
+    VminiRV* replay_cpu = new VminiRV;
+    VerilatedRestore is;
+    is.open(checkpoint.file.c_str());
+    is >> time;
+    is >> *replay_cpu;
+    is.close();
+
+    TraceFile* replay_tfp = new TraceFile;
+    replay_tfp->open(replay_cpu, REPLAY_VCD_FILE);
+
+    GoldenModelCPU replay_golden;
+    replay_golden.restore(golden_snapshot);
+
+    for (uint64_t cycle = checkpoint.cycle + 1; cycle <= failed_cycle; cycle++) {
+        RetireRecord designed, golden;
+        run_cycles(replay_cpu, replay_tfp, time, 1, nullptr, &designed);
+        try {
+            replay_golden.retire(&golden, 1);
+            if (compare_retired(&designed, &golden, 1, cycle) == 0) {
+                throw std::runtime_error("Retirement mismatch");
+            }
+            if (FULL_COMPARE) compare_cpus(replay_cpu, &replay_golden, (int)cycle);
+        } catch (const std::runtime_error& e) {
+            std::cout << "  Replay diverged at cycle " << cycle << ": " << e.what() << "\n";
+            break;
+        }
+    }
+
+    replay_tfp->close();
+    delete replay_tfp;
+    delete replay_cpu;
+    data_bus.redirect(nullptr);
+}
+
+
+// Lockstep run of one program on a fresh Verilated model and golden model.
+// Returns true if every cycle matched and the program did not exit with a
+// non-zero code. The run stops when the program halts (HaltDetector) or at
+// the first mismatch, which is reported, dumped and replayed as described above.
+bool run_program(const std::string& program_file) {
     uint64_t time = 0;
-    bool test_result = false;
     int test_count = 0;
     int test_success = 0;
- 
+    bool passed = true;
+
     // Set instruction memory file for this test
-    INSTRUCTION_MEMORY_FILE = "logisim-bin/sum.hex";
- 
-    // Initialize Verilator
-    Verilated::commandArgs(argc, argv);
-    Verilated::traceEverOn(true);
-    
-    // Create CPU and VCD trace
+    INSTRUCTION_MEMORY_FILE = program_file;
+    std::cout << "Program: " << INSTRUCTION_MEMORY_FILE << ", " << TEST_CYCLE_LIMIT << " cycles\n";
+
+    // Load the program once (from the program image cache when it has been
+    // seen before) for both the golden model and instruction_fetch.sv
+    ProgramImage program;
+    if (!program.loadCached(INSTRUCTION_MEMORY_FILE)) {
+        return false;
+    }
+    ProgramMemory program_memory(program);
+    ProgramMemory::select(&program_memory);
+
+    // The model's data memory: its own RAM holding the program, behind the
+    // same MemoryFabric the golden model uses for loads and stores
+    SparseMemory data_ram(GoldenModelCPU::DMEM_SIZE * 4);
+    MemoryFabric data_bus(data_ram);
+    data_bus.loadImage(program);
+    VgaFramebuffer vga;
+    UartDevice uart(UART_OUTPUT);
+    ExitPort exit_port;
+    map_devices(data_bus, vga, uart, exit_port);
+    // The run ends early once the program finishes (ebreak, a store to the
+    // exit port or a spin loop), checked before every cycle
+    HaltDetector halt(&exit_port, AM_HALT);
+    MemoryFabric::select(&data_bus);
+
+    std::string program_name = program_file.substr(program_file.find_last_of('/') + 1);
+    program_name = program_name.substr(0, program_name.find_last_of('.'));
+    FrameDumper vga_dumper(VGA_DUMP_FORMAT, VGA_DUMP_PREFIX + program_name);
+
+    // Create CPU, the in-memory trace ring and, with +trace_full, the full VCD trace.
+    // Each program gets a new model, whose instruction_fetch.sv and dmem port
+    // attach to program_memory and data_bus on its first eval()
     VminiRV* miniRV_cpu = new VminiRV;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    miniRV_cpu->trace(tfp, 99);
-    tfp->open("waveform_miniRV.vcd");
+    TraceFile* tfp = nullptr;
+    if (FULL_TRACE) {
+        tfp = new TraceFile;
+        tfp->open(miniRV_cpu, "waveform_miniRV.vcd");
+    }
+
+    TraceRing trace_ring(2 * TRACE_RING_CYCLES);    // Two samples (edges) per cycle
+    trace_ring.addSignal("clk", 1, &miniRV_cpu->clk);
+    trace_ring.addSignal("reset", 1, &miniRV_cpu->reset);
+    trace_ring.addSignal("pc", 32, &miniRV_cpu->pc);
+    trace_ring.addSignal("instruction", 32, &miniRV_cpu->instruction);
+    trace_ring.addSignal("registers", 32, &miniRV_cpu->registers[0], REGISTER_LIMIT);
     
     // Create golden model CPU
     GoldenModelCPU golden_cpu;
-    golden_cpu.loadHexFile(INSTRUCTION_MEMORY_FILE);
-    // after loading the instructions, it is also save new memh file in the same directory
+    golden_cpu.loadImage(program);
     golden_cpu.readMem();
     golden_cpu.resetCPU();
   
   
     // Initialize CPU - perform reset
     miniRV_cpu->reset = 1;  // Active high reset
-    run_cycles(miniRV_cpu, tfp, time, 1);
+    run_cycles(miniRV_cpu, tfp, time, 1, &trace_ring);
 
     // Release reset
     miniRV_cpu->reset = 0;  // Deactivate reset
@@ -152,43 +561,214 @@ int main(int argc, char** argv) {
     std::cout << "\t golden model pc after reset: \t" << golden_cpu.pc << "\n";
     std::cout << "\t miniRV cpu pc after reset: \t" << miniRV_cpu->pc << "\n\n";
 
-    test_result = compare_cpus(miniRV_cpu, &golden_cpu, 0);
-    if (!test_result) {
-        std::cout << "  err Cycle 0: CPU mismatch\n";
-        throw std::runtime_error("CPU mismatch");
+    try {
+        compare_cpus(miniRV_cpu, &golden_cpu, 0);
+        test_success++;
+    } catch (const std::runtime_error&) {
+        passed = false;
     }
-    test_success++;
     test_count++;
   
-    for (int i = 0; i < TEST_CYCLE_LIMIT; i++) {
-        std::cout << "\n======================\n";
-        // Execute one clock cycle on both CPUs
-        golden_cpu.clockCycle();
-        run_cycles(miniRV_cpu, tfp, time, 1);
-
-        // Compare states after clock cycle
-        test_result = compare_cpus(miniRV_cpu, &golden_cpu, i+1);
-        if (!test_result) {
-            std::cout << "  err Cycle " << std::setw(3) << i+1 << ": CPU mismatch\n";
-            throw std::runtime_error("CPU mismatch");
+    CheckpointLog checkpoints(CHECKPOINT_INTERVAL, CHECKPOINT_KEEP);
+    std::deque<RtlCheckpoint> rtl_checkpoints;
+    save_checkpoint(miniRV_cpu, data_bus, vga, exit_port, time, 0, rtl_checkpoints);
+
+    GoldenRetireStream golden_stream(golden_cpu, checkpoints, GOLDEN_THREAD);
+    if (passed) golden_stream.start((uint64_t)TEST_CYCLE_LIMIT);
+
+    std::vector<RetireRecord> designed_retired(RETIRE_BATCH);
+    std::vector<RetireRecord> golden_retired(RETIRE_BATCH);
+    uint64_t cycle = 0;
+    while (passed && cycle < (uint64_t)TEST_CYCLE_LIMIT) {
+        // Batches end at checkpoint cycles so both models are saved in step
+        uint64_t batch = std::min<uint64_t>(RETIRE_BATCH, (uint64_t)TEST_CYCLE_LIMIT - cycle);
+        batch = std::min<uint64_t>(batch, CHECKPOINT_INTERVAL - cycle % CHECKPOINT_INTERVAL);
+
+        // Run the RTL through the batch, recording what it retires; a halt
+        // shortens the batch to the cycles before it
+        for (uint64_t n = 0; n < batch; n++) {
+            if (halt.observe(miniRV_cpu->pc, miniRV_cpu->instruction, &miniRV_cpu->registers[0])) {
+                batch = n;
+                break;
+            }
+            if (VERBOSE_COMPARE) std::cout << "\n======================\n";
+            run_cycles(miniRV_cpu, tfp, time, 1, &trace_ring, &designed_retired[n]);
+
+            if (trace_dump_requested) {
+                trace_dump_requested = 0;
+                trace_ring.writeVcd(RING_VCD_FILE, "miniRV");
+            }
         }
+        uart.flush();
 
-        test_success++;
-        test_count++;
+        // Diff against the golden model's records for the same cycles
+        uint64_t failed_cycle = cycle + batch;
+        try {
+            size_t received = golden_stream.read(&golden_retired[0], batch);
+            size_t matched = compare_retired(&designed_retired[0], &golden_retired[0], received, cycle + 1);
+            if (matched != received) {
+                failed_cycle = cycle + 1 + matched;
+                throw std::runtime_error("Retirement mismatch");
+            }
+            if (received != batch) {
+                failed_cycle = cycle + 1 + received;
+                std::cout << "  err Cycle " << std::setw(3) << failed_cycle << ": Golden model stopped - "
+                          << golden_stream.error() << "\n";
+                throw std::runtime_error(golden_stream.error());
+            }
+            if (FULL_COMPARE) {
+                compare_cpus(miniRV_cpu, &golden_cpu, (int)failed_cycle);
+            }
+        } catch (const std::runtime_error&) {
+            golden_stream.stop();
+            if (trace_ring.writeVcd(RING_VCD_FILE, "miniRV")) {
+                std::cout << "  Last " << trace_ring.size() / 2 << " cycles written to " << RING_VCD_FILE << "\n";
+            }
+            const CpuSnapshot* nearest = checkpoints.nearest(failed_cycle);
+            if (nearest != nullptr && nearest->save(CHECKPOINT_FILE)) {
+                std::cout << "  Nearest golden checkpoint: cycle " << nearest->cycle
+                          << ", saved to " << CHECKPOINT_FILE << "\n";
+            }
+            for (size_t k = rtl_checkpoints.size(); nearest != nullptr && k > 0; k--) {
+                if (rtl_checkpoints[k - 1].cycle == nearest->cycle) {
+                    replay_interval(rtl_checkpoints[k - 1], data_bus, *nearest, failed_cycle);
+                    break;
+                }
+            }
+            test_success += (int)(failed_cycle - cycle - 1);
+            test_count += (int)(failed_cycle - cycle);
+            passed = false;
+            break;
+        }
+        cycle += batch;
+        if (cycle % CHECKPOINT_INTERVAL == 0) {
+            save_checkpoint(miniRV_cpu, data_bus, vga, exit_port, time, cycle, rtl_checkpoints);
+        }
+        if (cycle % VGA_DUMP_INTERVAL < batch) {
+            vga_dumper.dump(vga, cycle);
+        }
+
+        test_success += (int)batch;
+        test_count += (int)batch;
+        if (halt.reason() != HaltReason::None) break;
     }
 
     std::cout << "\n";
+
+    if (passed && halt.reason() != HaltReason::None) {
+        std::cout << "Program halted at cycle " << cycle << " (" << HaltDetector::reasonName(halt.reason())
+                  << ", pc = 0x" << std::hex << miniRV_cpu->pc << ", a0 = 0x" << halt.a0() << std::dec
+                  << "), exit code " << halt.exitCode() << "\n";
+    }
+    bool exit_failed = passed && halt.exitCode() != 0;
+    uart.flush();
+    if (uart.transmitted() > 0) {
+        std::cout << "UART: " << uart.transmitted() << " bytes\n";
+    }
+    vga_dumper.dump(vga, cycle);
+    if (vga_dumper.written() > 0) {
+        std::cout << "VGA: " << vga_dumper.written() << (VGA_DUMP_FORMAT == FrameFormat::Raw ? " records" : " frames")
+                  << " written to " << VGA_DUMP_PREFIX << program_name << "*\n";
+    }
+
+    if (TRACE_DUMP_AT_END) {
+        trace_ring.writeVcd(RING_VCD_FILE, "miniRV");
+    }
     
     // Cleanup
-    tfp->close();
-    delete tfp;
+    if (tfp) {
+        tfp->close();
+        delete tfp;
+    }
     delete miniRV_cpu;
+    for (size_t k = 0; k < rtl_checkpoints.size(); k++) {
+        std::remove(rtl_checkpoints[k].file.c_str());
+    }
     
-    if (test_success == test_count) {
+    if (!passed) {
+        std::cout << "❌ Mismatch after " << test_success << " matching cycles\n";
+    } else if (exit_failed) {
+        std::cout << "❌ Program exited with code " << halt.exitCode() << "\n";
+    } else if (test_success == test_count) {
         std::cout << "✅ All " << test_success << " tests passed!\n";
     } else {
         std::cout << "⚠️  " << test_count - test_success << " tests need implementation\n";
     }
-    
-    return (test_success == test_count) ? 0 : 1;
+    ProgramMemory::select(nullptr);
+    MemoryFabric::select(nullptr);
+
+    return passed && !exit_failed && test_success == test_count;
+}
+
+
+int main(int argc, char** argv) {
+    // Initialize Verilator
+    Verilated::commandArgs(argc, argv);
+    Verilated::traceEverOn(true);
+
+    // Programs to run back to back in this binary (+program=<file>, repeatable,
+    // default logisim-bin/sum.hex), each for +cycles=<n> lockstep cycles
+    std::vector<std::string> programs;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "+program=", strlen("+program=")) == 0) {
+            programs.push_back(argv[i] + strlen("+program="));
+        }
+    }
+    if (programs.empty()) {
+        programs.push_back("logisim-bin/sum.hex");
+    }
+    const char* cycles_arg = Verilated::commandArgsPlusMatch("cycles=");
+    if (cycles_arg != nullptr && cycles_arg[0] != '\0') {
+        TEST_CYCLE_LIMIT = std::stoi(cycles_arg + strlen("+cycles="));
+    }
+
+    const char* full_trace = Verilated::commandArgsPlusMatch("trace_full");
+    FULL_TRACE = full_trace != nullptr && full_trace[0] != '\0';
+    const char* dump_at_end = Verilated::commandArgsPlusMatch("trace_dump");
+    TRACE_DUMP_AT_END = dump_at_end != nullptr && dump_at_end[0] != '\0';
+    const char* verbose = Verilated::commandArgsPlusMatch("verbose");
+    VERBOSE_COMPARE = verbose != nullptr && verbose[0] != '\0';
+    const char* full_compare = Verilated::commandArgsPlusMatch("full_compare");
+    FULL_COMPARE = full_compare != nullptr && full_compare[0] != '\0';
+    if (FULL_COMPARE) RETIRE_BATCH = 1;
+    const char* golden_sync = Verilated::commandArgsPlusMatch("golden_sync");
+    GOLDEN_THREAD = !FULL_COMPARE && !(golden_sync != nullptr && golden_sync[0] != '\0');
+    const char* am_halt = Verilated::commandArgsPlusMatch("am_halt");
+    AM_HALT = am_halt != nullptr && am_halt[0] != '\0';
+    const char* vga_arg = Verilated::commandArgsPlusMatch("vga=");
+    if (vga_arg != nullptr && vga_arg[0] != '\0' && !FrameDumper::parseFormat(vga_arg + strlen("+vga="), VGA_DUMP_FORMAT)) {
+        std::cerr << "Error: +vga= must be ppm, raw or none" << std::endl;
+        return 1;
+    }
+    const char* uart_arg = Verilated::commandArgsPlusMatch("uart=");
+    if (uart_arg != nullptr && uart_arg[0] != '\0') {
+        const char* uart_file = uart_arg + strlen("+uart=");
+        UART_OUTPUT = fopen(uart_file, "w");
+        if (UART_OUTPUT == nullptr) {
+            std::cerr << "Error: Could not open file " << uart_file << std::endl;
+            return 1;
+        }
+    }
+    signal(SIGUSR1, request_trace_dump);
+
+    int failed = 0;
+    std::vector<bool> results;
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (i > 0) std::cout << "\n";
+        results.push_back(run_program(programs[i]));
+        if (!results.back()) failed++;
+    }
+
+    if (programs.size() > 1) {
+        std::cout << "\nProgram suite: " << programs.size() - failed << " passed, " << failed << " failed\n";
+        for (size_t i = 0; i < programs.size(); i++) {
+            std::cout << "  " << (results[i] ? "✅ " : "❌ ") << programs[i] << "\n";
+        }
+    }
+
+    if (UART_OUTPUT != stdout) {
+        fclose(UART_OUTPUT);
+    }
+
+    return failed == 0 ? 0 : 1;
 }
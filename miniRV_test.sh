@@ -1,9 +1,8 @@
 clear
 echo "Clearing screen..."
 
-echo "Removing obj_dir directory..."
-rm -rf obj_dir/
 
+source ./trace_flags.sh
 
 echo "Compiling miniRV Verilog files..."
 verilator --cc \
@@ -15,18 +14,22 @@ verilator --cc \
   program_counter.sv \
   register_file.sv \
   writeback_mux.sv \
-  --exe miniRV_test.cpp golden_model_cpu.cpp \
+  --exe miniRV_test.cpp golden_model_cpu.cpp golden_model_memory.cpp memory_fabric.cpp vga_device.cpp uart_device.cpp halt_detector.cpp program_image.cpp program_memory.cpp \
   --top-module miniRV \
-  --trace
+  --Mdir obj_dir/miniRV \
+  +define+PROGRAM_IMAGE_DPI \
+  --savable \
+  -LDFLAGS -pthread \
+  $TRACE_FLAGS
 
 echo "Linking miniRV Verilog files..."
-make -C obj_dir -f VminiRV.mk
+make -C obj_dir/miniRV -f VminiRV.mk
 
-echo "\n\nRunning ./obj_dir/VminiRV\n\n"
-./obj_dir/VminiRV
+echo "\n\nRunning ./obj_dir/miniRV/VminiRV\n\n"
+./obj_dir/miniRV/VminiRV
 
 # echo "Opening waveform_miniRV.vcd using GTKWave..."
 # gtkwave waveform_miniRV.vcd
 
-echo "\n\nSimulation complete. Waveform saved to waveform_miniRV.vcd\n\n"
-echo "You can view it using GTKWave: gtkwave waveform_miniRV.vcd\n\n"
\ No newline at end of file
+echo "\n\nSimulation complete. On a mismatch the last cycles are saved to waveform_miniRV_ring.vcd\n\n"
+echo "For a full-run waveform use ./obj_dir/miniRV/VminiRV +trace_full, then: gtkwave waveform_miniRV.vcd (.fst with TRACE=fst)\n\n"
\ No newline at end of file
@@ -1,7 +1,7 @@
 #include <iostream>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include "Vprogram_counter.h"
+#include "verilator_trace.h"
 
 
 uint32_t expected_value = 0x00;
@@ -14,7 +14,7 @@ void initialize_signals(Vprogram_counter* pc) {
     pc->clk = 0;
 }
 
-void clock_cycle(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+void clock_cycle(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     pc->clk = 0;
     pc->eval();
     tfp->dump(time++);
@@ -25,14 +25,14 @@ void clock_cycle(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
 }
 
 
-void reset_pc(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+void reset_pc(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     pc->reset = 1;
     clock_cycle(pc, tfp, time);
     pc->reset = 0;
 }
 
 
-bool test_reset(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_reset(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     initialize_signals(pc);
     expected_value = 0x00;
 
@@ -48,7 +48,7 @@ bool test_reset(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
 }
 
 
-bool test_increment_once(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_increment_once(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     initialize_signals(pc);
     reset_pc(pc, tfp, time);
     expected_value = 0x04;
@@ -65,7 +65,7 @@ bool test_increment_once(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& tim
 }
 
 
-bool test_increment_multiple(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_increment_multiple(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     initialize_signals(pc);
     reset_pc(pc, tfp, time);
     expected_value = 0x00;
@@ -84,7 +84,7 @@ bool test_increment_multiple(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t&
 }
 
 
-bool test_jalr(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_jalr(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     initialize_signals(pc);
     reset_pc(pc, tfp, time);
     expected_value = 0x0a;
@@ -104,7 +104,7 @@ bool test_jalr(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
 }
 
 
-bool test_increment_after_jalr(Vprogram_counter* pc, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_increment_after_jalr(Vprogram_counter* pc, TraceFile* tfp, uint64_t& time) {
     initialize_signals(pc);
     reset_pc(pc, tfp, time);
     expected_value = 0x0e;
@@ -133,12 +133,11 @@ int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Verilated::traceEverOn(true);
     
-    // Create module and VCD trace
+    // Create module and trace
     Vprogram_counter* pc = new Vprogram_counter;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    pc->trace(tfp, 99);
+    TraceFile* tfp = new TraceFile;
     const char* filename = "waveform_pc.vcd";
-    tfp->open(filename);
+    tfp->open(pc, filename);
     
     uint64_t time = 0;
     uint32_t expected_pc_out;
@@ -1,5 +1,5 @@
-rm -rf obj_dir/
-verilator --cc program_counter.sv --exe program_counter_test.cpp --trace
-make -C obj_dir -f Vprogram_counter.mk
-./obj_dir/Vprogram_counter
+source ./trace_flags.sh
+verilator --cc program_counter.sv --Mdir obj_dir/program_counter --exe program_counter_test.cpp $TRACE_FLAGS
+make -C obj_dir/program_counter -f Vprogram_counter.mk
+./obj_dir/program_counter/Vprogram_counter
 # gtkwave waveform_pc.vcd
\ No newline at end of file
@@ -0,0 +1,615 @@
+#include "program_image.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Program loader shared by the golden model and the Verilator testbenches.
+// Files are mapped read-only and parsed in place: no per-line std::string,
+// istringstream or stoul, which dominated start-up on the larger programs.
+
+
+// Hex digit values, -1 for every other character
+struct HexDigitTable {
+    int8_t value[256];
+
+    HexDigitTable() {
+        memset(value, -1, sizeof(value));
+        for (int c = '0'; c <= '9'; c++) value[c] = (int8_t)(c - '0');
+        for (int c = 'a'; c <= 'f'; c++) value[c] = (int8_t)(c - 'a' + 10);
+        for (int c = 'A'; c <= 'F'; c++) value[c] = (int8_t)(c - 'A' + 10);
+    }
+};
+
+static const HexDigitTable HEX_DIGITS;
+
+
+static inline int hexDigit(char c) {
+    return HEX_DIGITS.value[(uint8_t)c];
+}
+
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+
+
+// Scan a hex number of at most 8 digits at p. Returns the character after the
+// digits, or p itself if there are none or too many to fit in 32 bits.
+static inline const char* scanHexWord(const char* p, const char* end, uint32_t& value) {
+    // Fast path: every word in a Logisim image is exactly 8 digits. The digits
+    // are combined without per-digit branches; an invalid digit reads as -1,
+    // which sets the sign bit of `bad`.
+    if (end - p >= 8) {
+        int bad = 0;
+        uint32_t v = 0;
+        for (int i = 0; i < 8; i++) {
+            int d = hexDigit(p[i]);
+            bad |= d;
+            v = (v << 4) | (uint32_t)(d & 0xF);
+        }
+        if (bad >= 0 && (end - p == 8 || hexDigit(p[8]) < 0)) {
+            value = v;
+            return p + 8;
+        }
+    }
+
+    // Short words and addresses
+    const char* q = p;
+    uint32_t v = 0;
+    while (q < end && q - p < 8 && hexDigit(*q) >= 0) {
+        v = (v << 4) | (uint32_t)hexDigit(*q);
+        q++;
+    }
+    if (q < end && hexDigit(*q) >= 0) {
+        return p;
+    }
+    value = v;
+    return q;
+}
+
+
+// Little-endian field readers for the ELF headers
+static inline uint16_t readLE16(const char* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return (uint16_t)(b[0] | (b[1] << 8));
+}
+
+
+static inline uint32_t readLE32(const char* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+
+// Read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+    MappedFile() : data(nullptr), length(0), fd(-1) {}
+
+    ~MappedFile() {
+        if (data != nullptr && length > 0) munmap((void*)data, length);
+        if (fd >= 0) close(fd);
+    }
+
+    bool open(const std::string& filename) {
+        fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        length = (size_t)st.st_size;
+        if (length == 0) return true;
+
+        void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) return false;
+        madvise(map, length, MADV_SEQUENTIAL);
+        data = (const char*)map;
+        return true;
+    }
+
+    const char* data;
+    size_t length;
+
+private:
+    int fd;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+
+ProgramImage::ProgramImage() : image_format(FORMAT_NONE) {}
+
+
+// Format from the ELF magic number, then the extension; hex otherwise
+ProgramImage::Format ProgramImage::detectFormat(const std::string& filename, const char* data, size_t length) {
+    if (length >= 4 && memcmp(data, "\x7f" "ELF", 4) == 0) {
+        return FORMAT_ELF;
+    }
+    if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".bin") == 0) {
+        return FORMAT_BINARY;
+    }
+    return FORMAT_HEX;
+}
+
+
+// Map filename and parse it in the format given by its magic number or extension
+bool ProgramImage::load(const std::string& filename) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+
+    if (!parse(file.data, file.length, detectFormat(filename, file.data, file.length))) {
+        std::cerr << "Error: Cannot parse program file " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+// Program image cache
+//
+// <cache_dir>/<hash>.img holds a parsed image in host byte order:
+//   CacheHeader, segment_count CacheSegment entries, then each segment's
+//   bytes padded to 4. The file name and header carry the content hash of
+//   the source (seeded with its detected format), so an edited source simply
+//   misses and renamed or copied sources still hit.
+
+static const char CACHE_MAGIC[8] = {'M', 'R', 'V', 'I', 'M', 'G', '0', '1'};
+
+struct CacheHeader {
+    char magic[8];
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t format;
+    uint32_t segment_count;
+};
+
+struct CacheSegment {
+    uint32_t base;
+    uint32_t length;
+};
+
+
+std::string ProgramImage::cacheDirectory() {
+    const char* dir = getenv("MINIRV_PROGRAM_CACHE");
+    return dir != nullptr ? std::string(dir) : std::string(".program_cache");
+}
+
+
+// 8 bytes per step with a multiply-xorshift mix; not cryptographic, just a
+// cheap key that is far faster than re-parsing the text
+uint64_t ProgramImage::contentHash(const char* data, size_t length, uint64_t seed) {
+    const uint64_t K0 = 0x9E3779B97F4A7C15ull;
+    const uint64_t K1 = 0xBF58476D1CE4E5B9ull;
+    uint64_t h = seed ^ (length * K0);
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t k;
+        memcpy(&k, data + i, sizeof(k));
+        k *= K1;
+        k ^= k >> 31;
+        h = (h ^ k) * K0;
+    }
+    uint64_t tail = 0;
+    if (length > i) memcpy(&tail, data + i, length - i);
+    h = (h ^ (tail * K1)) * K0;
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+
+bool ProgramImage::loadCached(const std::string& filename, const std::string& cache_dir) {
+    if (cache_dir.empty()) {
+        return load(filename);
+    }
+
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Error: Cannot open file " << filename << std::endl;
+        return false;
+    }
+
+    Format detected = detectFormat(filename, file.data, file.length);
+    uint64_t hash = contentHash(file.data, file.length, detected);
+
+    std::ostringstream name;
+    name << cache_dir << "/" << std::hex << std::setfill('0') << std::setw(16) << hash << ".img";
+    const std::string cache_file = name.str();
+
+    if (readCacheFile(cache_file, hash, file.length)) {
+        return true;
+    }
+
+    if (!parse(file.data, file.length, detected)) {
+        std::cerr << "Error: Cannot parse program file " << filename << std::endl;
+        return false;
+    }
+
+    // A cache that cannot be written only costs the next run a parse
+    if (mkdir(cache_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        return true;
+    }
+    writeCacheFile(cache_file, hash, file.length);
+    return true;
+}
+
+
+// Map a cache file and copy its segments; false if missing, truncated or not
+// a match, in which case the caller reparses the program and rewrites the file
+bool ProgramImage::readCacheFile(const std::string& cache_file, uint64_t hash, size_t source_size) {
+    MappedFile cache;
+    if (!cache.open(cache_file) || cache.length < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header;
+    memcpy(&header, cache.data, sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.source_hash != hash || header.source_size != source_size ||
+        header.format == FORMAT_NONE || header.format > FORMAT_ELF ||
+        header.segment_count > (cache.length - sizeof(header)) / sizeof(CacheSegment)) {
+        return false;
+    }
+
+    const char* table = cache.data + sizeof(header);
+    size_t offset = sizeof(header) + (size_t)header.segment_count * sizeof(CacheSegment);
+
+    std::vector<ProgramSegment> cached(header.segment_count);
+    for (uint32_t i = 0; i < header.segment_count; i++) {
+        CacheSegment entry;
+        memcpy(&entry, table + (size_t)i * sizeof(entry), sizeof(entry));
+        // offset can pass the end once a segment's padding is cut off
+        if (offset > cache.length || entry.length > cache.length - offset) {
+            return false;
+        }
+        cached[i].base = entry.base;
+        cached[i].data.assign((const uint8_t*)cache.data + offset,
+                              (const uint8_t*)cache.data + offset + entry.length);
+        offset += (entry.length + 3) & ~(size_t)3;
+    }
+
+    segment_list.swap(cached);
+    image_format = (Format)header.format;
+    return true;
+}
+
+
+// Write the cache file under a temporary name and rename it into place, so
+// concurrent runs never map a partially written image
+bool ProgramImage::writeCacheFile(const std::string& cache_file, uint64_t hash, size_t source_size) const {
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.source_hash = hash;
+    header.source_size = source_size;
+    header.format = image_format;
+    header.segment_count = (uint32_t)segment_list.size();
+
+    std::string out((const char*)&header, sizeof(header));
+    for (size_t i = 0; i < segment_list.size(); i++) {
+        CacheSegment entry;
+        entry.base = segment_list[i].base;
+        entry.length = (uint32_t)segment_list[i].data.size();
+        out.append((const char*)&entry, sizeof(entry));
+    }
+    for (size_t i = 0; i < segment_list.size(); i++) {
+        const std::vector<uint8_t>& data = segment_list[i].data;
+        out.append((const char*)data.data(), data.size());
+        out.append((4 - data.size() % 4) % 4, '\0');
+    }
+
+    std::ostringstream tmp_name;
+    tmp_name << cache_file << ".tmp." << getpid();
+    const std::string tmp_file = tmp_name.str();
+
+    std::ofstream tmp(tmp_file, std::ios::binary);
+    if (!tmp.is_open()) {
+        return false;
+    }
+    tmp.write(out.data(), out.size());
+    tmp.close();
+    if (!tmp || rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+        remove(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool ProgramImage::parse(const char* begin, size_t length, Format format) {
+    segment_list.clear();
+    image_format = format;
+
+    const char* end = begin + length;
+    switch (format) {
+        case FORMAT_HEX:    return parseHex(begin, end);
+        case FORMAT_ELF:    return parseElf(begin, end);
+        case FORMAT_BINARY: parseBinary(begin, end); return true;
+        default:            return false;
+    }
+}
+
+
+void ProgramImage::appendWord(uint32_t word_addr, uint32_t word) {
+    uint32_t byte_addr = word_addr << 2;
+    if (segment_list.empty() ||
+        segment_list.back().base + segment_list.back().data.size() != byte_addr) {
+        ProgramSegment segment;
+        segment.base = byte_addr;
+        segment_list.push_back(segment);
+    }
+
+    std::vector<uint8_t>& data = segment_list.back().data;
+    uint8_t bytes[4] = {
+        (uint8_t)word, (uint8_t)(word >> 8), (uint8_t)(word >> 16), (uint8_t)(word >> 24)
+    };
+    data.insert(data.end(), bytes, bytes + 4);
+}
+
+
+// Logisim hex. The "v3.0 hex words addressed" format has a word address before
+// each line's words; lines without "addr:" are skipped. Files without that
+// header are plain word lists loaded from word 0, where "N*w" repeats w N times
+// (N in decimal, as Logisim writes it) and anything that is not a word ends
+// the line, so annotated dumps like test-2-ram.hex load their data words only.
+bool ProgramImage::parseHex(const char* p, const char* end) {
+    bool addressed = false;
+
+    // Optional "v3.0 hex ..." header line
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    if (eol == nullptr) eol = end;
+    const char* q = skipBlanks(p, eol);
+    if (eol - q >= 4 && memcmp(q, "v3.0", 4) == 0) {
+        std::string header(q, eol);
+        addressed = header.find("addressed") != std::string::npos;
+        p = eol < end ? eol + 1 : end;
+    }
+
+    uint32_t next_word = 0;
+    bool in_comment = false;
+    size_t line_number = addressed ? 1 : 0;
+
+    while (p < end) {
+        eol = (const char*)memchr(p, '\n', end - p);
+        if (eol == nullptr) eol = end;
+        line_number++;
+        q = p;
+        p = eol < end ? eol + 1 : end;
+
+        if (addressed) {
+            q = skipBlanks(q, eol);
+            uint32_t addr;
+            const char* t = scanHexWord(q, eol, addr);
+            if (t == q || t == eol || *t != ':') continue;
+            next_word = addr;
+            q = t + 1;
+
+            for (;;) {
+                q = skipBlanks(q, eol);
+                if (q == eol) break;
+                uint32_t word;
+                t = scanHexWord(q, eol, word);
+                if (t == q || (t != eol && !isBlank(*t))) {
+                    std::cerr << "Error: Malformed word on line " << line_number << std::endl;
+                    return false;
+                }
+                appendWord(next_word++, word);
+                q = t;
+            }
+            continue;
+        }
+
+        for (;;) {
+            if (in_comment) {
+                const char* close = q;
+                while (close + 1 < eol && !(close[0] == '*' && close[1] == '/')) close++;
+                if (close + 1 >= eol) break;
+                in_comment = false;
+                q = close + 2;
+            }
+
+            q = skipBlanks(q, eol);
+            if (q == eol) break;
+            if (eol - q >= 2 && q[0] == '/' && q[1] == '*') {
+                in_comment = true;
+                q += 2;
+                continue;
+            }
+
+            uint32_t word;
+            const char* t = scanHexWord(q, eol, word);
+            if (t == q) break;
+
+            uint32_t repeat = 1;
+            if (t != eol && *t == '*') {
+                // Run-length "N*w": N was scanned as hex, re-read it in decimal
+                repeat = 0;
+                for (const char* d = q; d < t; d++) {
+                    if (*d < '0' || *d > '9') { repeat = 0; t = q; break; }
+                    repeat = repeat * 10 + (uint32_t)(*d - '0');
+                }
+                if (t == q) break;
+                const char* w = t + 1;
+                t = scanHexWord(w, eol, word);
+                if (t == w) break;
+            }
+            if (t != eol && !isBlank(*t)) break;
+
+            for (uint32_t i = 0; i < repeat; i++) {
+                appendWord(next_word++, word);
+            }
+            q = t;
+        }
+    }
+
+    return true;
+}
+
+
+// Raw little-endian image loaded at address 0, padded to whole words
+void ProgramImage::parseBinary(const char* p, const char* end) {
+    if (p == end) return;
+
+    ProgramSegment segment;
+    segment.base = 0;
+    segment.data.assign((const uint8_t*)p, (const uint8_t*)end);
+    segment.data.resize((segment.data.size() + 3) & ~(size_t)3, 0);
+    segment_list.push_back(segment);
+}
+
+
+// ELF32 little-endian executable: every PT_LOAD segment is loaded at its
+// physical address, with p_memsz beyond p_filesz zero-filled (.bss)
+bool ProgramImage::parseElf(const char* p, const char* end) {
+    const size_t length = end - p;
+    const size_t EHDR_SIZE = 52;
+    const size_t PHDR_SIZE = 32;
+    const uint32_t PT_LOAD = 1;
+
+    if (length < EHDR_SIZE || p[4] != 1 /* ELFCLASS32 */ || p[5] != 1 /* ELFDATA2LSB */) {
+        std::cerr << "Error: Only 32-bit little-endian ELF files are supported" << std::endl;
+        return false;
+    }
+
+    uint32_t phoff = readLE32(p + 28);
+    uint16_t phentsize = readLE16(p + 42);
+    uint16_t phnum = readLE16(p + 44);
+    if (phentsize < PHDR_SIZE || phoff > length || (size_t)phnum * phentsize > length - phoff) {
+        std::cerr << "Error: Malformed ELF program header table" << std::endl;
+        return false;
+    }
+
+    for (uint16_t i = 0; i < phnum; i++) {
+        const char* ph = p + phoff + (size_t)i * phentsize;
+        if (readLE32(ph) != PT_LOAD) continue;
+
+        uint32_t offset = readLE32(ph + 4);
+        uint32_t paddr = readLE32(ph + 12);
+        uint32_t filesz = readLE32(ph + 16);
+        uint32_t memsz = readLE32(ph + 20);
+        if (offset > length || filesz > length - offset || memsz < filesz) {
+            std::cerr << "Error: Malformed ELF segment " << i << std::endl;
+            return false;
+        }
+        if (memsz == 0) continue;
+
+        ProgramSegment segment;
+        segment.base = paddr;
+        segment.data.reserve(memsz);
+        segment.data.assign((const uint8_t*)p + offset, (const uint8_t*)p + offset + filesz);
+        segment.data.resize(memsz, 0);
+        segment_list.push_back(segment);
+    }
+
+    return true;
+}
+
+
+uint32_t ProgramImage::wordAt(uint32_t word_addr) const {
+    uint32_t word = 0;
+    for (size_t i = 0; i < segment_list.size(); i++) {
+        const ProgramSegment& segment = segment_list[i];
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            uint32_t addr = (word_addr << 2) + lane;
+            if (addr >= segment.base && addr - segment.base < segment.data.size()) {
+                word |= (uint32_t)segment.data[addr - segment.base] << (8 * lane);
+            }
+        }
+    }
+    return word;
+}
+
+
+size_t ProgramImage::wordCount() const {
+    size_t words = 0;
+    for (size_t i = 0; i < segment_list.size(); i++) {
+        const ProgramSegment& segment = segment_list[i];
+        words += ((segment.base + segment.data.size() + 3) >> 2) - (segment.base >> 2);
+    }
+    return words;
+}
+
+
+uint32_t ProgramImage::endAddress() const {
+    uint32_t end_addr = 0;
+    for (size_t i = 0; i < segment_list.size(); i++) {
+        uint32_t segment_end = segment_list[i].base + (uint32_t)segment_list[i].data.size();
+        if (segment_end > end_addr) end_addr = segment_end;
+    }
+    return end_addr;
+}
+
+
+bool ProgramImage::writeMemh(const std::string& filename) const {
+    static const char UPPER_HEX[] = "0123456789ABCDEF";
+
+    std::ofstream memh_file(filename, std::ios::binary);
+    if (!memh_file.is_open()) {
+        std::cerr << "Error: Cannot create file " << filename << std::endl;
+        return false;
+    }
+
+    // Formatted into one buffer and written once; 9 characters per word
+    std::string out;
+    out.reserve(wordCount() * 9 + segment_list.size() * 10);
+
+    uint32_t next_word = 0;
+    for (size_t s = 0; s < segment_list.size(); s++) {
+        const ProgramSegment& segment = segment_list[s];
+        uint32_t first = segment.base >> 2;
+        uint32_t last = (uint32_t)((segment.base + segment.data.size() + 3) >> 2);
+
+        if (first != next_word) {
+            out += '@';
+            for (int shift = 28; shift >= 0; shift -= 4) out += UPPER_HEX[(first >> shift) & 0xF];
+            out += '\n';
+        }
+
+        for (uint32_t w = first; w < last; w++) {
+            uint32_t word = 0;
+            for (uint32_t lane = 0; lane < 4; lane++) {
+                uint32_t addr = (w << 2) + lane;
+                if (addr >= segment.base && addr - segment.base < segment.data.size()) {
+                    word |= (uint32_t)segment.data[addr - segment.base] << (8 * lane);
+                }
+            }
+            for (int shift = 28; shift >= 0; shift -= 4) out += UPPER_HEX[(word >> shift) & 0xF];
+            out += '\n';
+        }
+        next_word = last;
+    }
+
+    memh_file.write(out.data(), out.size());
+    return memh_file.good();
+}
+
+
+std::string ProgramImage::memhFilename(const std::string& filename) {
+    size_t slash = filename.find_last_of('/');
+    size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return filename + ".memh";
+    }
+    return filename.substr(0, dot) + ".memh";
+}
@@ -0,0 +1,89 @@
+#ifndef PROGRAM_IMAGE_H
+#define PROGRAM_IMAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Contiguous run of bytes loaded at a byte address
+struct ProgramSegment {
+    uint32_t base;                  // Byte address of data[0]
+    std::vector<uint8_t> data;      // Little-endian memory contents
+};
+
+// Program image read from disk, independent of the memory it is loaded into.
+// load() maps the file read-only and detects its format:
+//   - ELF32 little-endian executables (PT_LOAD segments at p_paddr)
+//   - raw little-endian binaries (*.bin), loaded at address 0
+//   - Logisim hex: "v3.0 hex words addressed" ("addr: w0 w1 ...", word
+//     addresses) or headerless/plain word lists ("w0 w1 ...", "N*w" runs),
+//     with /* */ comment blocks and non-hex lines skipped
+// The hex path is a table-driven scanner with a fixed 8-digit fast path,
+// since programs such as test-vga.hex are several hundred thousand words.
+class ProgramImage {
+public:
+    enum Format { FORMAT_NONE, FORMAT_HEX, FORMAT_BINARY, FORMAT_ELF };
+
+    ProgramImage();
+
+    // Replace the image with the contents of filename; false (after printing
+    // an error) if the file cannot be read or is malformed
+    bool load(const std::string& filename);
+
+    // load() through the program image cache: the source file is hashed and,
+    // if cache_dir holds an image for that hash, the pre-parsed segments are
+    // mapped from it instead of parsing the source again. On a miss the source
+    // is parsed and the image written to the cache for the next run. An empty
+    // cache_dir disables the cache.
+    bool loadCached(const std::string& filename, const std::string& cache_dir = cacheDirectory());
+
+    // Parse an in-memory image (the bytes of a hex, binary or ELF file)
+    bool parse(const char* begin, size_t length, Format format);
+
+    // Segments in file order; empty before load()
+    const std::vector<ProgramSegment>& segments() const { return segment_list; }
+
+    Format format() const { return image_format; }
+
+    // Word at word address word_addr, zero outside the segments
+    uint32_t wordAt(uint32_t word_addr) const;
+
+    // Number of 32-bit words across all segments (partial words round up)
+    size_t wordCount() const;
+
+    // One past the highest byte address covered by a segment
+    uint32_t endAddress() const;
+
+    // Write the image as a $readmemh file for instruction_fetch.sv: uppercase
+    // 8-digit words one per line, with @addr (word address) only at gaps.
+    // This is opt-in; loading never writes side files.
+    bool writeMemh(const std::string& filename) const;
+
+    // "dir/prog.hex" -> "dir/prog.memh"
+    static std::string memhFilename(const std::string& filename);
+
+    // Cache directory: $MINIRV_PROGRAM_CACHE if set (empty to disable),
+    // otherwise .program_cache in the working directory
+    static std::string cacheDirectory();
+
+    // 64-bit content hash used as the cache key
+    static uint64_t contentHash(const char* data, size_t length, uint64_t seed);
+
+private:
+    std::vector<ProgramSegment> segment_list;
+    Format image_format;
+
+    static Format detectFormat(const std::string& filename, const char* data, size_t length);
+    bool readCacheFile(const std::string& cache_file, uint64_t hash, size_t source_size);
+    bool writeCacheFile(const std::string& cache_file, uint64_t hash, size_t source_size) const;
+
+    bool parseHex(const char* p, const char* end);
+    bool parseElf(const char* p, const char* end);
+    void parseBinary(const char* p, const char* end);
+
+    // Append a word at word address word_addr, starting a new segment at gaps
+    void appendWord(uint32_t word_addr, uint32_t word);
+};
+
+#endif // PROGRAM_IMAGE_H
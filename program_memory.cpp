@@ -0,0 +1,41 @@
+#include "program_memory.h"
+#include <cstdint>
+
+// Memory picked up by the next instruction_fetch initial block
+static const ProgramMemory* selected_memory = nullptr;
+
+
+ProgramMemory::ProgramMemory(const ProgramImage& image, size_t bytes)
+    : memory(bytes), words((uint32_t)(bytes >> 2)) {
+    const std::vector<ProgramSegment>& segments = image.segments();
+    for (size_t i = 0; i < segments.size(); i++) {
+        const ProgramSegment& segment = segments[i];
+        if (segment.base >= bytes) continue;
+        size_t length = segment.data.size();
+        if (length > bytes - segment.base) length = bytes - segment.base;
+        memory.writeBlock(segment.base, segment.data.data(), length);
+    }
+}
+
+
+void ProgramMemory::select(const ProgramMemory* memory) {
+    selected_memory = memory;
+}
+
+
+const ProgramMemory* ProgramMemory::selected() {
+    return selected_memory;
+}
+
+
+// instruction_fetch.sv initial block: handle of the selected memory
+long long program_memory_attach() {
+    return (long long)(intptr_t)selected_memory;
+}
+
+
+// instruction_fetch.sv fetch: word word_index of the attached memory
+int program_memory_read(long long memory, int word_index) {
+    if (memory == 0) return 0;
+    return (int)reinterpret_cast<const ProgramMemory*>((intptr_t)memory)->word((uint32_t)word_index);
+}
@@ -0,0 +1,55 @@
+#ifndef PROGRAM_MEMORY_H
+#define PROGRAM_MEMORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include "golden_model_memory.h"
+#include "program_image.h"
+
+// Instruction memory behind instruction_fetch.sv when it is verilated with
+// +define+PROGRAM_IMAGE_DPI. The program is loaded once into sparse pages
+// (only the pages it occupies are allocated) and is read-only from then on,
+// so every instruction_fetch instance running it shares the same pages: an
+// instance holds a handle to the ProgramMemory instead of its own 16 MiB
+// array, and model construction no longer scales with the address space.
+//
+// Usage: build a ProgramMemory, select it with ProgramMemory::select(), then
+// construct models; each instruction_fetch attaches to the selected memory
+// in its initial block (first eval()). The ProgramMemory must outlive the
+// models attached to it. Different models can run different programs by
+// selecting another memory before constructing them.
+class ProgramMemory {
+public:
+    // instruction_fetch.sv address space: 2^22 words (24-bit byte addresses)
+    static constexpr size_t DEFAULT_BYTES = size_t(1) << 24;
+
+    explicit ProgramMemory(const ProgramImage& image, size_t bytes = DEFAULT_BYTES);
+
+    // Word at word_index, zero beyond the end of the memory
+    uint32_t word(uint32_t word_index) const {
+        return word_index < words ? memory.readWord(word_index << 2) : 0;
+    }
+
+    // Pages holding program data (the memory's footprint besides its page table)
+    size_t residentPages() const { return memory.dirtyPages(); }
+
+    // Memory the next instruction_fetch instances attach to (nullptr: none,
+    // they fetch zeros)
+    static void select(const ProgramMemory* memory);
+    static const ProgramMemory* selected();
+
+private:
+    SparseMemory memory;
+    uint32_t words;
+
+    ProgramMemory(const ProgramMemory&);
+    ProgramMemory& operator=(const ProgramMemory&);
+};
+
+// DPI imports of instruction_fetch.sv; the handle is the ProgramMemory address
+extern "C" {
+    long long program_memory_attach();
+    int program_memory_read(long long memory, int word_index);
+}
+
+#endif // PROGRAM_MEMORY_H
@@ -2,8 +2,8 @@
 #include <iomanip>
 #include <bitset>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include "Vregister_file.h"
+#include "verilator_trace.h"
 
 void print_registers(Vregister_file* rf, const std::string& msg) {
     std::cout << "  " << msg << "\n";
@@ -11,7 +11,7 @@ void print_registers(Vregister_file* rf, const std::string& msg) {
     std::cout << "    rdata2[" << (int)rf->raddr2 << "] = 0b" << std::bitset<32>((int)rf->rdata2) << "\n";
 }
 
-void clock_cycle(Vregister_file* rf, VerilatedVcdC* tfp, uint64_t& time) {
+void clock_cycle(Vregister_file* rf, TraceFile* tfp, uint64_t& time) {
     rf->clk = 0;
     rf->eval();
     tfp->dump(time++);
@@ -26,11 +26,10 @@ int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Verilated::traceEverOn(true);
     
-    // Create module and VCD trace
+    // Create module and trace
     Vregister_file* rf = new Vregister_file;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    rf->trace(tfp, 99);
-    tfp->open("waveform_register_file.vcd");
+    TraceFile* tfp = new TraceFile;
+    tfp->open(rf, "waveform_register_file.vcd");
     
     uint64_t time = 0;
     
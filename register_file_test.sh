@@ -1,5 +1,5 @@
-rm -rf obj_dir/
-verilator --cc register_file.sv --exe register_file_test.cpp --trace
-make -C obj_dir -f Vregister_file.mk
-./obj_dir/Vregister_file
+source ./trace_flags.sh
+verilator --cc register_file.sv --Mdir obj_dir/register_file --exe register_file_test.cpp $TRACE_FLAGS
+make -C obj_dir/register_file -f Vregister_file.mk
+./obj_dir/register_file/Vregister_file
 # gtkwave waveform_register_file.vcd
\ No newline at end of file
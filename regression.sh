@@ -0,0 +1,126 @@
+#!/bin/bash
+# Regression: every module testbench plus the miniRV lockstep test on every
+# program in logisim-bin/, run as a pool of concurrent jobs.
+#
+#   ./regression.sh                      # JOBS=$(nproc), CYCLES=10000000
+#   JOBS=4 CYCLES=1000000 ./regression.sh
+#   ./regression.sh sum.hex mem.hex      # miniRV on these programs only
+#
+# The testbenches are built once through CMake (BUILD_DIR, default
+# build_regression/, configured without tracing). Each job runs in its own directory regression/<job>/ (waveforms, checkpoints
+# and its log), so jobs never share files. Results are written to
+# regression/summary.json:
+#   {"passed": n, "failed": n, "wall_seconds": t, "jobs": [
+#     {"name": ..., "program": ..., "status": "pass"|"fail", "exit_code": n,
+#      "cycles": n|null, "wall_seconds": t, "log": ...}, ...]}
+# CYCLES is an upper bound: a miniRV job ends as soon as its program halts,
+# and reports the cycle it halted at. The exit code is 0 only if every job
+# passed.
+
+ROOT="$(cd "$(dirname "$0")" && pwd)"
+BUILD_DIR="${BUILD_DIR:-$ROOT/build_regression}"
+OUT_DIR="$ROOT/regression"
+JOBS="${JOBS:-$(nproc)}"
+CYCLES="${CYCLES:-10000000}"
+
+MODULE_TESTS="Valu Vcontrol_unit Vregister_file Vwriteback_mux Vprogram_counter Vinstruction_fetch halt_detector_test"
+PROGRAMS="$@"
+if [ -z "$PROGRAMS" ]; then
+    PROGRAMS="sum.hex mem.hex test-vga.hex task-1.hex task-2.hex test-lw.hex test-pc4.hex test.hex test-2-ram.hex"
+fi
+
+echo "Building testbenches in $BUILD_DIR..."
+cmake -S "$ROOT" -B "$BUILD_DIR" -DMINIRV_TRACE=none > /dev/null &&
+    cmake --build "$BUILD_DIR" -j"$JOBS" > "$BUILD_DIR/regression_build.log" 2>&1
+if [ $? -ne 0 ]; then
+    echo "Error: Build failed! See $BUILD_DIR/regression_build.log"
+    exit 1
+fi
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+# Parsed programs are shared by all jobs (cache writes are atomic renames)
+export MINIRV_PROGRAM_CACHE="$ROOT/.program_cache"
+
+now() {
+    date +%s.%N
+}
+
+# run_job <name> <program or ""> <cycles or ""> <command...>
+# Runs the command in regression/<name>/ and writes its JSON result there
+run_job() {
+    local name="$1" program="$2" cycles="$3"
+    shift 3
+    local dir="$OUT_DIR/$name"
+    mkdir -p "$dir"
+    ln -s "$ROOT/logisim-bin" "$dir/logisim-bin"
+
+    local start end status exit_code
+    start=$(now)
+    (cd "$dir" && "$@" > output.log 2>&1)
+    exit_code=$?
+    end=$(now)
+
+    # A program that finished reports the cycle it halted at
+    local halted
+    halted=$(grep -m1 -o "Program halted at cycle [0-9]*" "$dir/output.log" | grep -o "[0-9]*$")
+    [ -n "$cycles" ] && [ -n "$halted" ] && cycles="$halted"
+
+    status="pass"
+    if [ $exit_code -ne 0 ]; then
+        status="fail"
+        # A lockstep mismatch reports the cycle it failed at
+        local failed
+        failed=$(grep -m1 -o "err Cycle *[0-9]*" "$dir/output.log" | grep -o "[0-9]*$")
+        [ -n "$cycles" ] && cycles="${failed:-null}"
+    fi
+
+    printf '{"name": "%s", "program": %s, "status": "%s", "exit_code": %d, "cycles": %s, "wall_seconds": %.3f, "log": "%s"}\n' \
+        "$name" "$([ -n "$program" ] && echo "\"$program\"" || echo null)" "$status" "$exit_code" \
+        "${cycles:-null}" "$(echo "$end - $start" | awk '{ print $1 - $3 }')" "$dir/output.log" \
+        > "$dir/result.json"
+    echo "  $status  $name ($(echo "$end - $start" | awk '{ printf "%.2f", $1 - $3 }') s)"
+}
+
+# Start a job once fewer than JOBS are running
+start_job() {
+    while [ "$(jobs -rp | wc -l)" -ge "$JOBS" ]; do
+        wait -n
+    done
+    run_job "$@" &
+}
+
+echo "Running with $JOBS jobs..."
+START=$(now)
+for test in $MODULE_TESTS; do
+    start_job "$test" "" "" "$BUILD_DIR/$test"
+done
+for program in $PROGRAMS; do
+    start_job "miniRV-${program%.*}" "logisim-bin/$program" "$CYCLES" \
+        "$BUILD_DIR/VminiRV" "+program=logisim-bin/$program" "+cycles=$CYCLES"
+done
+wait
+END=$(now)
+
+# Summary, in submission order
+PASSED=0
+FAILED=0
+RESULTS=""
+for name in $MODULE_TESTS $(for program in $PROGRAMS; do echo "miniRV-${program%.*}"; done); do
+    result="$(cat "$OUT_DIR/$name/result.json")"
+    if echo "$result" | grep -q '"status": "pass"'; then
+        PASSED=$((PASSED + 1))
+    else
+        FAILED=$((FAILED + 1))
+    fi
+    RESULTS="$RESULTS${RESULTS:+,
+}    $result"
+done
+
+printf '{"passed": %d, "failed": %d, "wall_seconds": %.3f, "jobs": [\n%s\n]}\n' \
+    "$PASSED" "$FAILED" "$(echo "$END - $START" | awk '{ print $1 - $3 }')" "$RESULTS" \
+    > "$OUT_DIR/summary.json"
+
+echo ""
+echo "$PASSED passed, $FAILED failed. Summary: $OUT_DIR/summary.json"
+[ "$FAILED" -eq 0 ]
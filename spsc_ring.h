@@ -0,0 +1,68 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free single-producer / single-consumer ring of trivially copyable
+// values, used to hand golden-model retirement records from the golden
+// thread to the Verilator thread. Each side owns one index and only reads
+// the other's; the release store of an index publishes the slots before it.
+// Indices count forever and are masked on access, so a full ring holds all
+// `capacity` slots. push() and pop() move as many values as fit and never
+// block; waiting is up to the caller.
+template <class T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) : head(0), tail(0) {
+        size_t slot_count = 1;
+        while (slot_count < capacity) slot_count <<= 1;
+        slots.resize(slot_count);
+        mask = slot_count - 1;
+    }
+
+    // Producer: append up to count values, returns how many were appended
+    size_t push(const T* values, size_t count) {
+        size_t write = tail.load(std::memory_order_relaxed);
+        size_t space = slots.size() - (write - head.load(std::memory_order_acquire));
+        if (count > space) count = space;
+        for (size_t i = 0; i < count; i++) {
+            slots[(write + i) & mask] = values[i];
+        }
+        tail.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: remove up to count values, returns how many were removed
+    size_t pop(T* values, size_t count) {
+        size_t read = head.load(std::memory_order_relaxed);
+        size_t available = tail.load(std::memory_order_acquire) - read;
+        if (count > available) count = available;
+        for (size_t i = 0; i < count; i++) {
+            values[i] = slots[(read + i) & mask];
+        }
+        head.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    // Values waiting; exact for either side's own view
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    // Separate cache lines so producer and consumer do not false-share
+    alignas(64) std::atomic<size_t> head;   // Next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> tail;   // Next slot to push (producer)
+
+    SpscRing(const SpscRing&);
+    SpscRing& operator=(const SpscRing&);
+};
+
+#endif // SPSC_RING_H
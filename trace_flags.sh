@@ -0,0 +1,24 @@
+#!/bin/bash
+# Verilator trace options shared by the *_test.sh scripts (source ./trace_flags.sh)
+#   TRACE=vcd   (default) --trace, uncompressed waveform_*.vcd
+#   TRACE=fst   --trace-fst, compressed waveform_*.fst written by
+#               TRACE_THREADS (default 1) threads next to the simulation
+#   TRACE=none  no tracing code in the model at all
+# Sets TRACE_FLAGS for the verilator command line; the harnesses pick the
+# matching writer through verilator_trace.h.
+
+case "${TRACE:-vcd}" in
+    vcd)
+        TRACE_FLAGS="--trace"
+        ;;
+    fst)
+        TRACE_FLAGS="--trace-fst --trace-threads ${TRACE_THREADS:-1}"
+        ;;
+    none)
+        TRACE_FLAGS=""
+        ;;
+    *)
+        echo "Error: TRACE must be vcd, fst or none (got '$TRACE')"
+        exit 1
+        ;;
+esac
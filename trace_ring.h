@@ -0,0 +1,163 @@
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// In-memory signal history for the Verilator testbenches.
+// Registered signals are copied into a fixed ring of samples on every
+// sample() call (one per dumped clock edge), which is a handful of memcpys
+// instead of a formatted VCD write. The last `depth` samples can be written
+// as a VCD when something goes wrong (or on request); passing runs never
+// touch the disk.
+class TraceRing {
+public:
+    explicit TraceRing(size_t depth)
+        : depth(depth ? depth : 1), record_bytes(0), count(0), next(0) {}
+
+    // Watch `count` consecutive values of `width` bits (1..64) at `value`,
+    // stored in 1, 2, 4 or 8 bytes as Verilator does (CData/SData/IData/QData).
+    // Arrays of more than one value are named name[0], name[1], ...
+    void addSignal(const std::string& name, int width, const void* value, size_t count = 1) {
+        size_t bytes = width <= 8 ? 1 : width <= 16 ? 2 : width <= 32 ? 4 : 8;
+
+        // Arrays are copied in one piece
+        Span span;
+        span.source = static_cast<const uint8_t*>(value);
+        span.offset = record_bytes;
+        span.bytes = count * bytes;
+        spans.push_back(span);
+
+        for (size_t i = 0; i < count; i++) {
+            Signal signal;
+            signal.name = count > 1 ? name + "[" + std::to_string(i) + "]" : name;
+            signal.width = width;
+            signal.bytes = bytes;
+            signal.offset = record_bytes;
+            signals.push_back(signal);
+            record_bytes += bytes;
+        }
+        clear();
+    }
+
+    // Record the current value of every signal at `time`
+    void sample(uint64_t time) {
+        if (records.empty()) {
+            records.resize(depth * record_bytes);
+            times.resize(depth);
+        }
+        uint8_t* record = &records[next * record_bytes];
+        for (size_t i = 0; i < spans.size(); i++) {
+            memcpy(record + spans[i].offset, spans[i].source, spans[i].bytes);
+        }
+        times[next] = time;
+        next = next + 1 == depth ? 0 : next + 1;
+        if (count < depth) count++;
+    }
+
+    // Forget all samples
+    void clear() {
+        records.clear();
+        times.clear();
+        count = 0;
+        next = 0;
+    }
+
+    size_t size() const { return count; }
+
+    // Write the buffered samples, oldest first, as a VCD under module `scope`.
+    // The first sample is dumped in full, later ones only where a value changed.
+    bool writeVcd(const std::string& filename, const std::string& scope) const {
+        std::ofstream vcd(filename);
+        if (!vcd.is_open()) {
+            std::cerr << "Error: Cannot create file " << filename << std::endl;
+            return false;
+        }
+
+        vcd << "$timescale 1ps $end\n";
+        vcd << "$scope module " << scope << " $end\n";
+        for (size_t i = 0; i < signals.size(); i++) {
+            vcd << "$var wire " << signals[i].width << " " << identifier(i) << " "
+                << signals[i].name << " $end\n";
+        }
+        vcd << "$upscope $end\n$enddefinitions $end\n";
+
+        size_t first = (next + depth - count) % depth;
+        const uint8_t* previous = nullptr;
+        for (size_t n = 0; n < count; n++) {
+            size_t slot = (first + n) % depth;
+            const uint8_t* record = &records[slot * record_bytes];
+            vcd << "#" << times[slot] << "\n";
+            if (previous == nullptr) vcd << "$dumpvars\n";
+            for (size_t i = 0; i < signals.size(); i++) {
+                uint64_t value = read(record, signals[i]);
+                if (previous != nullptr && value == read(previous, signals[i])) continue;
+                writeValue(vcd, value, signals[i].width, identifier(i));
+            }
+            if (previous == nullptr) vcd << "$end\n";
+            previous = record;
+        }
+        return vcd.good();
+    }
+
+private:
+    struct Signal {
+        std::string name;
+        int width;
+        size_t bytes;
+        size_t offset;
+    };
+
+    // Contiguous source bytes copied by one memcpy per sample
+    struct Span {
+        const uint8_t* source;
+        size_t offset;
+        size_t bytes;
+    };
+
+    size_t depth;
+    size_t record_bytes;
+    size_t count;       // Valid samples (up to depth)
+    size_t next;        // Slot written by the next sample()
+    std::vector<Signal> signals;
+    std::vector<Span> spans;
+    std::vector<uint8_t> records;
+    std::vector<uint64_t> times;
+
+    static uint64_t read(const uint8_t* record, const Signal& signal) {
+        uint64_t value = 0;
+        memcpy(&value, record + signal.offset, signal.bytes);   // Little-endian host
+        if (signal.width < 64) value &= (1ull << signal.width) - 1;
+        return value;
+    }
+
+    // Short VCD identifier from the printable range '!'..'~'
+    static std::string identifier(size_t index) {
+        std::string id;
+        do {
+            id += (char)('!' + index % 94);
+            index /= 94;
+        } while (index > 0);
+        return id;
+    }
+
+    static void writeValue(std::ostream& vcd, uint64_t value, int width, const std::string& id) {
+        if (width == 1) {
+            vcd << (value & 1) << id << "\n";
+            return;
+        }
+        char bits[65];
+        int n = 0;
+        for (int bit = width - 1; bit >= 0; bit--) {
+            bits[n++] = (value >> bit) & 1 ? '1' : '0';
+        }
+        bits[n] = '\0';
+        vcd << "b" << bits << " " << id << "\n";
+    }
+};
+
+#endif // TRACE_RING_H
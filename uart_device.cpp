@@ -0,0 +1,48 @@
+#include "uart_device.h"
+
+constexpr uint32_t UartDevice::BASE;
+constexpr uint32_t UartDevice::SIZE;
+constexpr size_t UartDevice::BUFFER_SIZE;
+
+
+UartDevice::UartDevice(FILE* output)
+    : out(output), count(0) {
+    pending.reserve(BUFFER_SIZE);
+}
+
+
+UartDevice::~UartDevice() {
+    flush();
+}
+
+
+// LSR (byte 5): THR empty and transmitter empty
+uint32_t UartDevice::read(uint32_t offset) {
+    return offset == 4 ? 0x60u << 8 : 0;
+}
+
+
+// THR (byte 0); writes to the other registers are ignored
+void UartDevice::write(uint32_t offset, uint32_t wdata, uint8_t wstrb) {
+    if (offset != 0 || !(wstrb & 1)) return;
+    count++;
+    if (out == nullptr) return;
+    pending.push_back((char)(wdata & 0xFF));
+    if (pending.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+
+void UartDevice::setOutput(FILE* output) {
+    flush();
+    out = output;
+}
+
+
+void UartDevice::flush() {
+    if (pending.empty()) return;
+    fwrite(pending.data(), 1, pending.size(), out);
+    fflush(out);
+    pending.clear();
+}
@@ -0,0 +1,50 @@
+#ifndef UART_DEVICE_H
+#define UART_DEVICE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "memory_fabric.h"
+
+// Output-only serial port at BASE, register-compatible with the transmit side
+// of a 16550 (the AM runtime's putch is `sb a0, 0(0x10000000)`):
+//   +0 THR  write: the byte in lane 0 is transmitted
+//   +5 LSR  read: 0x60, transmitter always empty
+// Transmitted bytes are buffered and written to the output FILE in batches:
+// when BUFFER_SIZE bytes are pending or on flush(), which the owner calls at
+// the end of a run (and whenever it wants the output to catch up). Without
+// an output the bytes are only counted.
+class UartDevice : public MmioDevice {
+public:
+    static constexpr uint32_t BASE = 0x10000000;
+    static constexpr uint32_t SIZE = 8;
+    static constexpr size_t BUFFER_SIZE = 4096;
+
+    explicit UartDevice(FILE* output = nullptr);
+    ~UartDevice();
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t wdata, uint8_t wstrb) override;
+
+    // Where flushed bytes go (stdout, a file, or nullptr to discard); the
+    // pending bytes are flushed to the previous output first. The FILE is
+    // not closed by the device.
+    void setOutput(FILE* output);
+
+    // Write out the pending bytes
+    void flush();
+
+    // Bytes transmitted so far
+    uint64_t transmitted() const { return count; }
+
+private:
+    FILE* out;
+    std::vector<char> pending;
+    uint64_t count;
+
+    UartDevice(const UartDevice&);
+    UartDevice& operator=(const UartDevice&);
+};
+
+#endif // UART_DEVICE_H
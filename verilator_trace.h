@@ -0,0 +1,93 @@
+#ifndef VERILATOR_TRACE_H
+#define VERILATOR_TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <verilated.h>
+
+// Waveform output shared by the *_test.cpp harnesses.
+// The format is chosen when the model is verilated (see trace_flags.sh):
+//   TRACE=vcd  --trace                      VerilatedVcdC, *.vcd
+//   TRACE=fst  --trace-fst --trace-threads  VerilatedFstC, *.fst (compressed,
+//                                           written by a separate thread)
+//   TRACE=none (no trace flag)              every call is a no-op
+// Verilator's generated makefile passes VM_TRACE / VM_TRACE_FST to the
+// testbench build, so the harness code is the same for all three. At run
+// time +notrace skips opening the file.
+#if VM_TRACE_FST
+#include <verilated_fst_c.h>
+typedef VerilatedFstC VerilatedTraceFileC;
+#elif VM_TRACE
+#include <verilated_vcd_c.h>
+typedef VerilatedVcdC VerilatedTraceFileC;
+#endif
+
+class TraceFile {
+public:
+    TraceFile() : file(nullptr) {}
+    ~TraceFile() { close(); }
+
+    // Trace `model` into filename; ".vcd" is replaced by ".fst" in FST builds.
+    // Returns false (and traces nothing) without tracing support or with +notrace.
+    template <class Model>
+    bool open(Model* model, const std::string& filename, int levels = 99) {
+#if VM_TRACE
+        const char* notrace = Verilated::commandArgsPlusMatch("notrace");
+        if (notrace != nullptr && notrace[0] != '\0') {
+            return false;
+        }
+        Verilated::traceEverOn(true);
+        file = new VerilatedTraceFileC;
+        model->trace(file, levels);
+        file->open(traceFilename(filename).c_str());
+        return true;
+#else
+        (void)model;
+        (void)filename;
+        (void)levels;
+        return false;
+#endif
+    }
+
+    void dump(uint64_t time) {
+#if VM_TRACE
+        if (file != nullptr) file->dump(time);
+#else
+        (void)time;
+#endif
+    }
+
+    void close() {
+#if VM_TRACE
+        if (file != nullptr) {
+            file->close();
+            delete file;
+            file = nullptr;
+        }
+#endif
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // "waveform_x.vcd" -> "waveform_x.fst" when tracing FST
+    static std::string traceFilename(const std::string& filename) {
+#if VM_TRACE_FST
+        if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".vcd") == 0) {
+            return filename.substr(0, filename.size() - 4) + ".fst";
+        }
+#endif
+        return filename;
+    }
+
+private:
+#if VM_TRACE
+    VerilatedTraceFileC* file;
+#else
+    void* file;
+#endif
+
+    TraceFile(const TraceFile&);
+    TraceFile& operator=(const TraceFile&);
+};
+
+#endif // VERILATOR_TRACE_H
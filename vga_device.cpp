@@ -0,0 +1,159 @@
+#include "vga_device.h"
+#include <iostream>
+
+constexpr uint32_t VgaFramebuffer::BASE;
+constexpr uint32_t VgaFramebuffer::WIDTH;
+constexpr uint32_t VgaFramebuffer::HEIGHT;
+constexpr uint32_t VgaFramebuffer::ROW_BYTES;
+constexpr uint32_t VgaFramebuffer::BYTES;
+constexpr uint32_t FrameDumper::RAW_MAGIC;
+
+
+VgaFramebuffer::VgaFramebuffer()
+    : pixels(BYTES), dirty_rows(HEIGHT, 0), dirty_count(0) {
+}
+
+
+uint32_t VgaFramebuffer::read(uint32_t offset) {
+    return offset < BYTES ? pixels.readWord(offset) : 0;
+}
+
+
+// Merge the strobed lanes; the scanline is only dirty if the pixel changed
+void VgaFramebuffer::write(uint32_t offset, uint32_t wdata, uint8_t wstrb) {
+    if (offset >= BYTES) return;
+    uint32_t old_pixel = pixels.readWord(offset);
+    pixels.writeStrobe(offset, wdata, wstrb);
+    if (pixels.readWord(offset) == old_pixel) return;
+
+    uint32_t y = offset / ROW_BYTES;
+    if (!dirty_rows[y]) {
+        dirty_rows[y] = 1;
+        dirty_count++;
+    }
+}
+
+
+void VgaFramebuffer::markClean() {
+    if (dirty_count == 0) return;
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        dirty_rows[y] = 0;
+    }
+    dirty_count = 0;
+}
+
+
+void VgaFramebuffer::clear() {
+    pixels.clear();
+    markClean();
+}
+
+
+void VgaFramebuffer::restore(const MemorySnapshot& snap) {
+    pixels.restore(snap);
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        dirty_rows[y] = 1;
+    }
+    dirty_count = HEIGHT;
+}
+
+
+FrameDumper::FrameDumper(FrameFormat format, const std::string& prefix)
+    : format(format), prefix(prefix), raw(nullptr), count(0) {
+}
+
+
+FrameDumper::~FrameDumper() {
+    if (raw != nullptr) {
+        fclose(raw);
+    }
+}
+
+
+bool FrameDumper::parseFormat(const std::string& name, FrameFormat& format) {
+    if (name == "ppm") format = FrameFormat::Ppm;
+    else if (name == "raw") format = FrameFormat::Raw;
+    else if (name == "none") format = FrameFormat::None;
+    else return false;
+    return true;
+}
+
+
+bool FrameDumper::dump(VgaFramebuffer& vga, uint64_t cycle) {
+    if (format == FrameFormat::None || !vga.dirty()) return false;
+    bool written = format == FrameFormat::Ppm ? writePpm(vga, cycle) : writeRaw(vga, cycle);
+    vga.markClean();
+    return written;
+}
+
+
+// Whole frame as binary PPM (P6, 8-bit RGB)
+bool FrameDumper::writePpm(const VgaFramebuffer& vga, uint64_t cycle) {
+    std::string filename = prefix + "_" + std::to_string(count) + ".ppm";
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return false;
+    }
+    fprintf(file, "P6\n# cycle %llu\n%u %u\n255\n", (unsigned long long)cycle,
+            VgaFramebuffer::WIDTH, VgaFramebuffer::HEIGHT);
+
+    buffer.resize(VgaFramebuffer::WIDTH * 3);
+    for (uint32_t y = 0; y < VgaFramebuffer::HEIGHT; y++) {
+        for (uint32_t x = 0; x < VgaFramebuffer::WIDTH; x++) {
+            uint32_t pixel = vga.pixel(x, y);
+            buffer[3 * x] = (uint8_t)(pixel >> 16);
+            buffer[3 * x + 1] = (uint8_t)(pixel >> 8);
+            buffer[3 * x + 2] = (uint8_t)pixel;
+        }
+        fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+    fclose(file);
+    count++;
+    return true;
+}
+
+
+static void appendLittleEndian(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+
+// One record per run of consecutive dirty scanlines, appended to <prefix>.raw
+bool FrameDumper::writeRaw(const VgaFramebuffer& vga, uint64_t cycle) {
+    if (raw == nullptr) {
+        std::string filename = prefix + ".raw";
+        raw = fopen(filename.c_str(), "wb");
+        if (raw == nullptr) {
+            std::cerr << "Error: Could not open file " << filename << std::endl;
+            return false;
+        }
+    }
+
+    uint32_t y = 0;
+    while (y < VgaFramebuffer::HEIGHT) {
+        if (!vga.rowDirty(y)) {
+            y++;
+            continue;
+        }
+        uint32_t first_row = y;
+        while (y < VgaFramebuffer::HEIGHT && vga.rowDirty(y)) y++;
+
+        buffer.clear();
+        appendLittleEndian(buffer, RAW_MAGIC, 4);
+        appendLittleEndian(buffer, cycle, 8);
+        appendLittleEndian(buffer, first_row, 4);
+        appendLittleEndian(buffer, y - first_row, 4);
+        for (uint32_t row = first_row; row < y; row++) {
+            for (uint32_t x = 0; x < VgaFramebuffer::WIDTH; x++) {
+                appendLittleEndian(buffer, vga.pixel(x, row), 4);
+            }
+        }
+        fwrite(buffer.data(), 1, buffer.size(), raw);
+        count++;
+    }
+    fflush(raw);
+    return true;
+}
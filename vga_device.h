@@ -0,0 +1,98 @@
+#ifndef VGA_DEVICE_H
+#define VGA_DEVICE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "golden_model_memory.h"
+#include "memory_fabric.h"
+
+// Memory-mapped VGA framebuffer, as drawn by the AM runtime of test-vga.hex:
+// WIDTH x HEIGHT 32-bit pixels (0x00RRGGBB), row-major, at BASE. Pixels live
+// in a SparseMemory, so an idle framebuffer costs a page table, and every
+// write that changes a pixel marks its scanline dirty. FrameDumper writes out
+// only what changed since its last dump.
+class VgaFramebuffer : public MmioDevice {
+public:
+    static constexpr uint32_t BASE = 0x20000000;
+    static constexpr uint32_t WIDTH = 256;
+    static constexpr uint32_t HEIGHT = 256;
+    static constexpr uint32_t ROW_BYTES = WIDTH * 4;
+    static constexpr uint32_t BYTES = ROW_BYTES * HEIGHT;
+
+    VgaFramebuffer();
+
+    uint32_t read(uint32_t offset) override;
+    void write(uint32_t offset, uint32_t wdata, uint8_t wstrb) override;
+
+    uint32_t pixel(uint32_t x, uint32_t y) const { return pixels.readWord(y * ROW_BYTES + x * 4); }
+
+    // Scanlines changed since the last markClean()
+    bool dirty() const { return dirty_count != 0; }
+    bool rowDirty(uint32_t y) const { return dirty_rows[y] != 0; }
+    size_t dirtyRows() const { return dirty_count; }
+    void markClean();
+
+    // Black screen, nothing dirty
+    void clear();
+
+    // Pixels, shared copy-on-write like SparseMemory::snapshot. A restored
+    // frame counts as changed in every scanline.
+    MemorySnapshot snapshot() { return pixels.snapshot(); }
+    void restore(const MemorySnapshot& snap);
+
+private:
+    SparseMemory pixels;
+    std::vector<uint8_t> dirty_rows;
+    size_t dirty_count;
+};
+
+
+// How FrameDumper writes frames
+enum class FrameFormat {
+    None,   // Nothing is written
+    Ppm,    // <prefix>_<n>.ppm: the whole frame (binary P6) each time it changed
+    Raw     // <prefix>.raw: one record per run of changed scanlines
+};
+
+// Writes a VgaFramebuffer's changes when dump() is called (the testbench
+// calls it every VGA_DUMP_INTERVAL cycles and at the end of a run); a dump
+// with no dirty scanline writes nothing.
+//
+// Raw record, all fields little-endian: magic 'VGAR' (u32), cycle (u64),
+// first_row (u32), row_count (u32), then row_count * WIDTH pixels (u32
+// 0x00RRGGBB). Replaying the records in order rebuilds every dumped frame.
+class FrameDumper {
+public:
+    static constexpr uint32_t RAW_MAGIC = 0x52414756;   // "VGAR"
+
+    FrameDumper(FrameFormat format, const std::string& prefix);
+    ~FrameDumper();
+
+    // Write the changes of `vga` (at `cycle`) and mark it clean. Returns true
+    // if anything was written.
+    bool dump(VgaFramebuffer& vga, uint64_t cycle);
+
+    // Frames (PPM) or records (raw) written so far
+    size_t written() const { return count; }
+
+    // "ppm", "raw" or "none"; returns false for anything else
+    static bool parseFormat(const std::string& name, FrameFormat& format);
+
+private:
+    FrameFormat format;
+    std::string prefix;
+    FILE* raw;
+    size_t count;
+    std::vector<uint8_t> buffer;
+
+    bool writePpm(const VgaFramebuffer& vga, uint64_t cycle);
+    bool writeRaw(const VgaFramebuffer& vga, uint64_t cycle);
+
+    FrameDumper(const FrameDumper&);
+    FrameDumper& operator=(const FrameDumper&);
+};
+
+#endif // VGA_DEVICE_H
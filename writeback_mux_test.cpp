@@ -3,8 +3,8 @@
 #include <bitset>
 #include <random>
 #include <verilated.h>
-#include <verilated_vcd_c.h>
 #include "Vwriteback_mux.h"
+#include "verilator_trace.h"
 
 
 uint32_t generate_random_32bit() {
@@ -15,7 +15,7 @@ uint32_t generate_random_32bit() {
 }
 
 
-bool test_writeback_selection(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& time
+bool test_writeback_selection(Vwriteback_mux* wb_mux, TraceFile* tfp, uint64_t& time
     , uint8_t wb_sel, uint32_t alu_result, uint32_t mem_rdata, uint32_t pc_plus4, uint32_t imm_u, uint32_t expected_wb_data) {
     std::cout << "Test: Writeback Selection\n";
 
@@ -42,7 +42,7 @@ bool test_writeback_selection(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64
 }
 
 
-bool test_wb_sel_alu_result(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_wb_sel_alu_result(Vwriteback_mux* wb_mux, TraceFile* tfp, uint64_t& time) {
     std::cout << "Test: Writeback Selection ALU Result (wb_sel = 00)\n";
     std::cout << "  Format: wb_sel[1:0] = 2'b00 -> wb_data = alu_result\n";
     
@@ -68,7 +68,7 @@ bool test_wb_sel_alu_result(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t
 }
 
 
-bool test_wb_sel_mem_rdata(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_wb_sel_mem_rdata(Vwriteback_mux* wb_mux, TraceFile* tfp, uint64_t& time) {
     std::cout << "Test: Writeback Selection Memory Read Data (wb_sel = 01)\n";
     std::cout << "  Format: wb_sel[1:0] = 2'b01 -> wb_data = mem_rdata\n";
         
@@ -94,7 +94,7 @@ bool test_wb_sel_mem_rdata(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t&
 }
 
 
-bool test_wb_sel_pc_plus4(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_wb_sel_pc_plus4(Vwriteback_mux* wb_mux, TraceFile* tfp, uint64_t& time) {
     std::cout << "Test: Writeback Selection PC+4 (wb_sel = 10)\n";
     std::cout << "  Format: wb_sel[1:0] = 2'b10 -> wb_data = pc_plus4\n";
     
@@ -120,7 +120,7 @@ bool test_wb_sel_pc_plus4(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t&
 }
 
 
-bool test_wb_sel_imm_u(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_wb_sel_imm_u(Vwriteback_mux* wb_mux, TraceFile* tfp, uint64_t& time) {
     std::cout << "Test: Writeback Selection Immediate U-Type (wb_sel = 11)\n";
     std::cout << "  Format: wb_sel[1:0] = 2'b11 -> wb_data = imm_u\n";
     
@@ -146,7 +146,7 @@ bool test_wb_sel_imm_u(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& tim
 }
 
 
-bool test_all_selections_comprehensive(Vwriteback_mux* wb_mux, VerilatedVcdC* tfp, uint64_t& time) {
+bool test_all_selections_comprehensive(Vwriteback_mux* wb_mux, TraceFile* tfp, uint64_t& time) {
     std::cout << "Test: Comprehensive Writeback Selection Test\n";
     std::cout << "  Testing all selection values with various input combinations\n";
     
@@ -195,11 +195,10 @@ int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Verilated::traceEverOn(true);
     
-    // Create module and VCD trace
+    // Create module and trace
     Vwriteback_mux* wb_mux = new Vwriteback_mux;
-    VerilatedVcdC* tfp = new VerilatedVcdC;
-    wb_mux->trace(tfp, 99);
-    tfp->open("waveform_writeback_mux.vcd");
+    TraceFile* tfp = new TraceFile;
+    tfp->open(wb_mux, "waveform_writeback_mux.vcd");
     
     uint64_t time = 0;
     bool test_result = false;
@@ -1,8 +1,8 @@
 #!/bin/bash
 # Test Writeback Multiplexer
-rm -rf obj_dir/
-verilator --cc writeback_mux.sv --exe writeback_mux_test.cpp --trace
-make -C obj_dir -f Vwriteback_mux.mk
-./obj_dir/Vwriteback_mux
+source ./trace_flags.sh
+verilator --cc writeback_mux.sv --Mdir obj_dir/writeback_mux --exe writeback_mux_test.cpp $TRACE_FLAGS
+make -C obj_dir/writeback_mux -f Vwriteback_mux.mk
+./obj_dir/writeback_mux/Vwriteback_mux
 # gtkwave waveform_writeback_mux.vcd
 